@@ -19,6 +19,36 @@
 #include "stdbool.h"
 #include "assert.h"
 
+// Scatter/gather segments: POSIX struct iovec where there is one
+#if defined(__unix__) || defined(__APPLE__)
+#define CB_HAS_FDIO 1
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+typedef struct iovec cb_iov_t;
+#else
+typedef struct
+{
+    void *iov_base;
+    size_t iov_len;
+}cb_iov_t;
+#endif
+
+#if defined(__linux__)
+#define CB_HAS_MIRRORED 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+// Vector byte scan (CbFind). Define CB_NO_SIMD to force the scalar loop.
+#if !defined(CB_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#elif !defined(CB_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 #ifndef UNUSED_VAR
@@ -33,31 +63,645 @@
 
 #define CB_ASSERT(b) assert(b)
 
+#if !defined(__STDC_NO_ATOMICS__)
+#define CB_HAS_ATOMICS 1
+#include "stdatomic.h"
+#include "stdalign.h"
+#endif
+
+// Blocking wait/notify (Linux futex + eventfd)
+#if defined(CB_HAS_MIRRORED) && defined(CB_HAS_ATOMICS)
+#define CB_HAS_WAIT 1
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+// Process-shared rings in POSIX shared memory, needs the CB_SPSC atomic indices
+#if defined(CB_HAS_MIRRORED) && defined(CB_SPSC)
+#define CB_HAS_SHARED 1
+#include <stddef.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#endif
+
+// Monotonic ns clock for the timestamp side-ring. Define CB_NOW_NS() before
+// including to use another source (MCU tick counter, test clock).
+#if !defined(CB_NOW_NS) && (defined(__unix__) || defined(__APPLE__))
+#include <time.h>
+#define CB_NOW_NS() CbNowNs()
+static inline uint64_t CbNowNs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+#ifdef CB_NOW_NS
+#define CB_HAS_TS 1
+#endif
+
+#ifndef CB_CACHELINE_SZ
+#define CB_CACHELINE_SZ 64
+#endif
+
+/*
+    CB_SPSC: single producer / single consumer lock-free mode.
+    write is only stored by the producer and read only by the consumer, both
+    published with release and observed with acquire, so the bytes behind an
+    index are visible before the index itself. The producer never moves read:
+    CbWrite drops (returns 0) instead of overwriting, and a DMA overrun is
+    resolved on the consumer side by skipping to the newest data.
+
+    Layout: producer owned and consumer owned fields sit on their own cache
+    lines, and each side keeps a private copy of the opposite index
+    (read_cache / write_cache). CbWrite and CbRead only reload the shared
+    index when the copy shows too little room or data, so in steady state
+    the only line that moves between cores is the one being published.
+    Define CB_PACKED_LAYOUT for the opposite: both indices and the counters
+    packed on one cache line with no index copies (false-sharing baseline
+    for benchmarks, or tight memory).
+*/
+#ifdef CB_SPSC
+typedef _Atomic size_t cb_idx_t;
+#define CB_LOAD_RLX(idx)      atomic_load_explicit(&(idx), memory_order_relaxed)
+#define CB_LOAD_ACQ(idx)      atomic_load_explicit(&(idx), memory_order_acquire)
+#define CB_STORE_REL(idx, v)  atomic_store_explicit(&(idx), (v), memory_order_release)
+#define CB_STORE_RLX(idx, v)  atomic_store_explicit(&(idx), (v), memory_order_relaxed)
+#ifndef CB_PACKED_LAYOUT
+#define CB_ALIGN_LINE         alignas(CB_CACHELINE_SZ)
+#define CB_IDX_CACHE          1
+#else
+#define CB_ALIGN_LINE
+#endif
+#else
+typedef size_t cb_idx_t;
+#define CB_LOAD_RLX(idx)      (idx)
+#define CB_LOAD_ACQ(idx)      (idx)
+#define CB_STORE_REL(idx, v)  ((idx) = (v))
+#define CB_STORE_RLX(idx, v)  ((idx) = (v))
+#define CB_ALIGN_LINE
+#endif
+
+// Statistics counters: one writer each, readable from any thread (relaxed)
+typedef cb_idx_t cb_cnt_t;
+#define CB_CNT_ADD(cnt, v)    CB_STORE_RLX(cnt, CB_LOAD_RLX(cnt) + (v))
+
+// What CbWrite does when the data does not fit. DMA writes always land.
+typedef enum{
+    CB_POLICY_OVERWRITE = 0U, // drop the oldest bytes (CB_SPSC: acts as DROP_NEWEST)
+    CB_POLICY_DROP_NEWEST,    // refuse the whole write
+    CB_POLICY_BLOCK,          // wait for space, needs CB_SPSC and CbNotifyInit (otherwise DROP_NEWEST)
+}cb_policy_e;
+
 typedef struct
 {
-    uint8_t *data;
+    size_t used;
+    size_t full_cnt;       // writes that did not fit
+    size_t bytes_dropped;  // refused, overwritten or lost to a DMA overrun
+    size_t high_watermark; // max data count seen by the producer
+    size_t wraps;          // times the write index went past the end
+    size_t read_stalls;    // reads that found the buffer empty
+}cb_stats_t;
+
+typedef struct cb_notify_t cb_notify_t;
+typedef struct cb_ts_t cb_ts_t;
+typedef struct cb_wm_t cb_wm_t;
+
+typedef struct
+{
+#ifdef CB_PACKED_LAYOUT
+    // one line shared by producer and consumer
+    _Alignas(CB_CACHELINE_SZ) cb_idx_t write;
+    cb_idx_t read;
+    size_t read_last;
+    cb_cnt_t full_cnt;
+    cb_cnt_t dropped;
+    cb_cnt_t max_used;
+    cb_cnt_t wraps;
+    cb_cnt_t read_stalls;
+    size_t dma_cnt;
+#endif
+    uint8_t *data;   // NULL for process-shared rings, see data_off
+    size_t data_off; // shared rings: memory starts data_off bytes after the cb_t
     size_t size;
-    size_t write;
-    size_t read;
     size_t mask;
     const char *name;
-    
-    size_t read_last;
+    bool mirrored; // data is mapped twice back to back (CbInitMirrored)
+    cb_notify_t *ntf; // optional wait/notify block (CbNotifyInit)
+    cb_ts_t *ts;      // optional arrival timestamps (CbTsInit)
+    cb_wm_t *wm;      // optional backpressure watermarks (CbWatermarkInit)
+
+    cb_policy_e policy;
+
+#ifndef CB_PACKED_LAYOUT
+    // producer side
+    CB_ALIGN_LINE cb_idx_t write;
     size_t dma_cnt;
-    size_t full_cnt;
+    cb_cnt_t full_cnt;
+    cb_cnt_t dropped;
+    cb_cnt_t max_used;
+    cb_cnt_t wraps;
+#ifdef CB_IDX_CACHE
+    size_t read_cache;  // last read seen by the producer
+#endif
+
+    // consumer side
+    CB_ALIGN_LINE cb_idx_t read;
+    size_t read_last;
+    cb_cnt_t read_stalls;
+#ifdef CB_IDX_CACHE
+    size_t write_cache; // last write seen by the consumer
+#endif
+#endif // CB_PACKED_LAYOUT
 } cb_t;
 
+// A contiguous region of the ring memory. A wrapped range is split in two.
+typedef struct
+{
+    uint8_t *ptr;
+    size_t len;
+} cb_span_t;
+
 
 // APIs
 void CbInit(cb_t* cb, uint8_t * data, size_t size, const char *name);
 size_t CbWrite(cb_t * cb, const uint8_t * item, size_t n);
 size_t CbRead(cb_t * cb, uint8_t * out, size_t n);
 size_t CbReadUntil(cb_t * cb, uint8_t * out, size_t max, uint8_t byte);
+size_t CbFind(cb_t * cb, uint8_t byte);
+size_t CbWritev(cb_t * cb, const cb_iov_t * iov, size_t iovcnt);
+size_t CbReadv(cb_t * cb, const cb_iov_t * iov, size_t iovcnt);
+#ifdef CB_HAS_FDIO
+// Direct fd I/O: readv into the free spans / writev from the data spans,
+// no bounce buffer. Return as read/write (-1 + errno, 0 = EOF on receive).
+ssize_t CbRecvFromFd(cb_t * cb, int fd);
+ssize_t CbSendToFd(cb_t * cb, int fd);
+#endif
+void CbSetPolicy(cb_t * cb, cb_policy_e policy);
+cb_stats_t CbStats(cb_t * cb);
+
+#ifdef CB_HAS_MIRRORED
+// Double-mapped memory (Linux): size must be a power of 2 and a multiple of the page size
+bool CbInitMirrored(cb_t * cb, size_t size, const char *name);
+void CbFreeMirrored(cb_t * cb);
+#endif
+
+#ifdef CB_HAS_SHARED
+/*
+    Process-shared ring: the cb_t and its (mirrored) memory live in one
+    shm_open segment, so the same CbWrite/CbRead/CbPeekSpans... work from any
+    process that maps it. Nothing in the segment is an absolute pointer: data
+    is NULL and the memory is found through data_off. name, ntf and the
+    wait API are process local and not available on shared rings.
+    Crash recovery: a segment whose creator died before publishing it is
+    rebuilt by the next CbCreateShared, and every attach sanitises the
+    indices a dead peer may have left behind.
+*/
+#define CB_SHM_MAGIC    0x48534243u // "CBSH"
+#define CB_SHM_VERSION  1u
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hdr_sz;               // sizeof(cb_shm_t) of the creator, layout check
+    _Atomic uint32_t ready;        // stored last by the creator
+    _Atomic int32_t creator;       // pid initialising the segment
+    _Atomic uint32_t attach_cnt;   // bumped on every attach, peers can spot restarts
+    size_t size;
+    size_t data_off;               // from the segment start, page aligned
+    char name[32];
+    cb_t cb;
+}cb_shm_t;
+
+// size: power of 2 and multiple of the page size. Reattaches to a compatible
+// existing segment without touching its data.
+cb_t * CbCreateShared(const char *name, size_t size);
+cb_t * CbOpenShared(const char *name);
+void CbCloseShared(cb_t * cb);
+bool CbUnlinkShared(const char *name);
+#endif // CB_HAS_SHARED
+
+#ifdef CB_HAS_MIRRORED
+/*
+    Spill journal: optional overflow path for CbWrite-style producers. While
+    the ring stays under high_wm nothing changes. Past it new data is
+    appended to a second ring laid over an mmap'd file, and keeps going there
+    until the reader has drained the file, so ordering is always
+    memory -> journal -> memory. The reader takes memory first and the file
+    when memory is empty. Same threading rules as the cb_t it wraps.
+    The first page of the file keeps the journal indices: whatever was not
+    read survives a process restart and CbSpillInit replays it before any
+    new data (no msync, so a power loss can lose it).
+*/
+#define CB_SPILL_MAGIC 0x4C4C495053424355ull // "UCBSPILL"
+
+typedef struct
+{
+    uint64_t magic;     // CB_SPILL_MAGIC once the header is valid
+    uint64_t size;      // journal bytes after the header page
+    uint64_t write;     // disk ring indices (masked), producer updates write
+    uint64_t read;      // consumer updates read
+}cb_spill_hdr_t;
+
+typedef struct
+{
+    cb_t *cb;
+    cb_t disk;          // ring over the journal file mapping
+    cb_spill_hdr_t *hdr; // first page of the mapping
+    int fd;
+    size_t high_wm;
+
+    size_t spilled;     // bytes that went through the file
+    size_t episodes;    // times spilling started
+    size_t refused;     // bytes refused with the file full too
+    bool spilling;      // producer private
+}cb_spill_t;
+
+typedef struct
+{
+    size_t high_wm; // ring data count above which writes spill (0 = ring full)
+}cb_spill_opt_t;
+
+// file_sz: power of 2, multiple of the page size, the file takes one page more.
+// An existing journal of the same size is reopened and its unread data replayed.
+#define CbSpillInit(sp, cb, path, file_sz, ...) \
+    cb_spill_init__opt((sp), (cb), (path), (file_sz), (cb_spill_opt_t){__VA_ARGS__})
+bool cb_spill_init__opt(cb_spill_t * sp, cb_t * cb, const char * path, size_t file_sz, cb_spill_opt_t opt);
+size_t CbSpillWrite(cb_spill_t * sp, const uint8_t * item, size_t n);
+size_t CbSpillRead(cb_spill_t * sp, uint8_t * out, size_t n);
+size_t CbSpillCount(cb_spill_t * sp);
+void CbSpillClose(cb_spill_t * sp);
+#endif // CB_HAS_MIRRORED
+
+#ifdef CB_HAS_TS
+/*
+    Arrival timestamps: a side-ring of (first byte index, ns) entries, one
+    per CbWriteInc (CbWrite, CbDmaWrInc, CbWriteCommit...), pushed before the
+    bytes are published and pruned by CbReadInc. Every CbReadInc that
+    consumes data adds the age of its oldest byte to a log2 histogram.
+    When the side-ring is full a chunk is charged to the previous entry,
+    which can only overstate its age.
+*/
+#define CB_LAT_BUCKETS 64 // bucket i counts latencies in [2^i, 2^(i+1)) ns
+
+typedef struct
+{
+    size_t pos;  // free running write index of the chunk's first byte
+    uint64_t ns;
+}cb_ts_entry_t;
+
+typedef struct cb_ts_t
+{
+    cb_ts_entry_t *ent;
+    size_t mask;
+    CB_ALIGN_LINE cb_idx_t head; // producer
+    size_t merged;               // chunks charged to the previous entry
+    CB_ALIGN_LINE cb_idx_t tail; // consumer
+    uint64_t hist[CB_LAT_BUCKETS];
+    uint64_t lat_cnt;
+    uint64_t lat_sum;
+    uint64_t lat_max;
+}cb_ts_t;
+
+// ent: n entries of caller memory, n power of 2. Not on CbCreateShared
+// rings (returns false): ts is a pointer into this process only.
+bool CbTsInit(cb_t * cb, cb_ts_t * ts, cb_ts_entry_t * ent, size_t n);
+bool CbOldestTs(cb_t * cb, uint64_t * ns);
+uint64_t CbLatPercentile(const cb_ts_t * ts, double pct);
+void CbLatReset(cb_ts_t * ts);
+#endif // CB_HAS_TS
+
+/*
+    Backpressure watermarks with hysteresis: on_high runs in CbWriteInc when
+    the data count reaches high, on_low in CbReadInc when it falls back to
+    low, strictly alternating, so they map directly to pause/resume of a
+    sender. Each runs on the thread that moved the index (producer for
+    high, consumer for low); CbAboveHigh() gives the current state. On Linux
+    an eventfd can be signalled on both edges instead of, or as well as,
+    the callbacks.
+*/
+typedef void (*cb_wm_fn_t)(cb_t * cb, void * ctx);
+
+typedef struct
+{
+    size_t high;       // data count that fires on_high (0 = 3/4 of the ring)
+    size_t low;        // data count that fires on_low after a high (default high / 2)
+    cb_wm_fn_t on_high;
+    cb_wm_fn_t on_low;
+    void *ctx;
+    bool eventfd;      // CbWatermarkFd is readable on every edge
+}cb_wm_opt_t;
+
+typedef struct cb_wm_t
+{
+    cb_wm_opt_t cfg;
+    cb_idx_t above;    // set by the producer, cleared by the consumer
+    int evfd;
+    size_t highs;      // producer: high edges seen
+    size_t lows;       // consumer: low edges seen
+}cb_wm_t;
+
+// Not on CbCreateShared rings (returns false): wm, its callbacks and ctx
+// are pointers into this process only.
+#define CbWatermarkInit(cb, wm, ...) cb_wm_init__opt((cb), (wm), (cb_wm_opt_t){__VA_ARGS__})
+bool cb_wm_init__opt(cb_t * cb, cb_wm_t * wm, cb_wm_opt_t opt);
+void CbWatermarkClose(cb_t * cb);
+int CbWatermarkFd(cb_t * cb);
+bool CbAboveHigh(cb_t * cb);
+
+#ifdef CB_HAS_WAIT
+// Wait/notify. Index updates only make a syscall when a waiter is parked and
+// its threshold is crossed, or for the eventfd on empty->non-empty and on
+// crossing high_wm upwards. Without a notify block nothing changes.
+// Waiting on another thread's progress needs CB_SPSC indices.
+typedef struct cb_notify_t
+{
+    _Atomic uint32_t rd_seq; // futex words
+    _Atomic uint32_t wr_seq;
+    _Atomic size_t rd_need;  // bytes a parked reader waits for, 0 = none
+    _Atomic size_t wr_need;  // free bytes a parked writer waits for, 0 = none
+    size_t high_wm;
+    int evfd;
+}cb_notify_t;
+
+typedef struct
+{
+    size_t high_wm; // eventfd also fires when the data count reaches it (0 = off)
+    bool eventfd;   // create an eventfd for epoll (CbNotifyFd)
+}cb_notify_opt_t;
+
+#define CbNotifyInit(cb, ntf, ...) cb_notify_init__opt((cb), (ntf), (cb_notify_opt_t){__VA_ARGS__})
+bool cb_notify_init__opt(cb_t * cb, cb_notify_t * ntf, cb_notify_opt_t opt);
+void CbNotifyClose(cb_t * cb);
+int CbNotifyFd(cb_t * cb);
+bool CbWaitReadable(cb_t * cb, size_t min_bytes, int timeout_ms);
+bool CbWaitWritable(cb_t * cb, size_t min_bytes, int timeout_ms);
+#endif // CB_HAS_WAIT
+
+// Zero-copy
+size_t CbPeekSpans(cb_t * cb, cb_span_t span[2]);
+void CbReadCommit(cb_t * cb, size_t n);
+size_t CbWriteReserve(cb_t * cb, cb_span_t span[2]);
+void CbWriteCommit(cb_t * cb, size_t n);
 
 // DMA
 void CbDmaSynStart(cb_t * cb, uint8_t start_B);
 void CbDmaWrInc(cb_t * cb, int32_t ndtr);
 
+// DMA frame decoder. Wire format:
+//   [sync (sync_len B)] ... [length (len_sz B) at len_off] ... [payload (length B)] [crc]
+// The header is len_off + len_sz bytes and includes the sync word. The CRC
+// covers everything after the sync word up to the CRC itself. On a bad
+// length or CRC the decoder drops one byte and hunts for the next sync word.
+typedef enum{
+    CB_CRC_NONE = 0U,
+    CB_CRC16_CCITT, // poly 0x1021, init 0xFFFF (CCITT-FALSE)
+    CB_CRC32,       // IEEE 802.3 reflected, as zlib
+}cb_crc_e;
+
+typedef struct
+{
+    uint32_t sync;      // sync word, most significant byte first on the wire
+    uint8_t sync_len;   // 1..4 bytes
+    uint8_t len_off;    // offset of the length field from the frame start
+    uint8_t len_sz;     // 1 or 2 bytes
+    bool len_le;        // little endian length (default big endian)
+    cb_crc_e crc;
+    bool crc_le;        // little endian CRC (default big endian)
+    size_t max_payload; // longer lengths are treated as corruption (0 = ring size)
+}cb_frame_cfg_t;
+
+typedef struct
+{
+    cb_t *cb;
+    cb_frame_cfg_t cfg;
+    size_t hdr_sz;
+    size_t crc_sz;
+    size_t pending;     // bytes of the frame handed out and not yet released
+
+    size_t frames;
+    size_t crc_errors;
+    size_t len_errors;
+    size_t resyncs;     // times bytes were discarded to find a sync word
+    size_t skipped;     // bytes discarded while hunting
+}cb_frame_dec_t;
+
+typedef struct
+{
+    cb_span_t span[2];  // whole frame in the ring, sync word to CRC
+    size_t len;         // whole frame length
+    size_t payload_off; // payload starts payload_off bytes into the frame
+    size_t payload_len;
+}cb_frame_t;
+
+#define CbFrameInit(dec, cb, ...) cb_frame_init__opt((dec), (cb), (cb_frame_cfg_t){__VA_ARGS__})
+void cb_frame_init__opt(cb_frame_dec_t * dec, cb_t * cb, cb_frame_cfg_t cfg);
+bool CbFrameNext(cb_frame_dec_t * dec, cb_frame_t * frame);
+void CbFrameRelease(cb_frame_dec_t * dec);
+size_t CbFramePayload(const cb_frame_t * frame, uint8_t * out, size_t max);
+uint16_t CbCrc16(uint16_t crc, const uint8_t * p, size_t n);
+uint32_t CbCrc32(uint32_t crc, const uint8_t * p, size_t n);
+
+// Framed messages: variable size records that never straddle the wrap.
+// Each record is a 32 bit header (length, bit 31 = timestamp follows), the
+// optional 64 bit timestamp and the payload, padded to CB_MSG_ALIGN. When a
+// record does not fit before the end a skip marker fills the tail. Records
+// are never overwritten, a full ring refuses them. Do not mix with CbWrite.
+#define CB_MSG_ALIGN      8u
+#define CB_MSG_TS_FLAG    0x80000000u
+#define CB_MSG_SKIP       0xFFFFFFFFu
+#define CB_MSG_MAX_LEN    (CB_MSG_TS_FLAG - 1u)
+
+typedef struct
+{
+    uint64_t ts; // 0 = no timestamp
+}cb_msg_opt_t;
+
+typedef struct
+{
+    uint8_t *data; // points into the ring, valid until CbDropMsg
+    size_t len;
+    uint64_t ts;
+}cb_msg_t;
+
+#define CbPushMsg(cb, payload, len, ...) cb_push_msg__opt((cb), (payload), (len), (cb_msg_opt_t){__VA_ARGS__})
+bool cb_push_msg__opt(cb_t * cb, const void * payload, size_t len, cb_msg_opt_t opt);
+bool CbPeekMsg(cb_t * cb, cb_msg_t * msg);
+void CbDropMsg(cb_t * cb);
+bool CbPopMsg(cb_t * cb, uint8_t * out, size_t max, cb_msg_t * msg);
+
+
+/*
+    CB_DECLARE(name, T): ring of whole T records, generated per type.
+    Defines name##_t and name##Init/Count/Free/Push/Pop/PushN/PopN plus the
+    span API (PeekSpans/ReadCommit/WriteReserve/WriteCommit) over T*.
+    Indices follow the cb_t mode (atomic under CB_SPSC). Records are never
+    overwritten: a full ring refuses new ones and counts them in full_cnt.
+    Capacity is the full size since indices are free running.
+*/
+#define CB_DECLARE(name, T)                                                         \
+typedef struct { T *ptr; size_t len; } name##_span_t;                               \
+typedef struct                                                                      \
+{                                                                                   \
+    T *data;                                                                        \
+    size_t size;                                                                    \
+    size_t mask;                                                                    \
+    const char *name;                                                               \
+    CB_ALIGN_LINE cb_idx_t write;                                                   \
+    size_t full_cnt;                                                                \
+    CB_ALIGN_LINE cb_idx_t read;                                                    \
+} name##_t;                                                                         \
+                                                                                    \
+static inline void name##Init(name##_t * cb, T * data, size_t size, const char *nm){ \
+    CB_ASSERT(cb != NULL && data != NULL && size != 0 && (size & (size - 1)) == 0); \
+    cb->data = data;                                                                \
+    cb->size = size;                                                                \
+    cb->mask = size - 1;                                                            \
+    cb->name = nm ? nm : "";                                                        \
+    cb->full_cnt = 0;                                                               \
+    CB_STORE_REL(cb->write, 0);                                                     \
+    CB_STORE_REL(cb->read, 0);                                                      \
+}                                                                                   \
+static inline size_t name##Count(name##_t * cb){                                    \
+    return CB_LOAD_ACQ(cb->write) - CB_LOAD_ACQ(cb->read);                          \
+}                                                                                   \
+static inline size_t name##Free(name##_t * cb){                                     \
+    return cb->size - name##Count(cb);                                              \
+}                                                                                   \
+static inline size_t name##SpansAt(name##_t * cb, size_t pos, size_t n,             \
+                                   name##_span_t span[2]){                          \
+    size_t off = pos & cb->mask, till_end = cb->size - off;                         \
+    span[0].ptr = &cb->data[off];                                                   \
+    span[0].len = (n < till_end) ? n : till_end;                                    \
+    span[1].ptr = cb->data;                                                         \
+    span[1].len = n - span[0].len;                                                  \
+    return n;                                                                       \
+}                                                                                   \
+static inline size_t name##PeekSpans(name##_t * cb, name##_span_t span[2]){         \
+    size_t r = CB_LOAD_RLX(cb->read);                                               \
+    return name##SpansAt(cb, r, CB_LOAD_ACQ(cb->write) - r, span);                  \
+}                                                                                   \
+static inline void name##ReadCommit(name##_t * cb, size_t n){                       \
+    size_t r = CB_LOAD_RLX(cb->read);                                               \
+    size_t avail = CB_LOAD_ACQ(cb->write) - r;                                      \
+    CB_STORE_REL(cb->read, r + ((n < avail) ? n : avail));                          \
+}                                                                                   \
+static inline size_t name##WriteReserve(name##_t * cb, name##_span_t span[2]){      \
+    size_t w = CB_LOAD_RLX(cb->write);                                              \
+    return name##SpansAt(cb, w, cb->size - (w - CB_LOAD_ACQ(cb->read)), span);      \
+}                                                                                   \
+static inline void name##WriteCommit(name##_t * cb, size_t n){                      \
+    CB_ASSERT(n <= name##Free(cb));                                                 \
+    CB_STORE_REL(cb->write, CB_LOAD_RLX(cb->write) + n);                            \
+}                                                                                   \
+static inline size_t name##PushN(name##_t * cb, const T * items, size_t n){         \
+    name##_span_t span[2];                                                          \
+    size_t space = name##WriteReserve(cb, span);                                    \
+    if(n > space){ cb->full_cnt++; n = space; }                                     \
+    size_t n0 = (n < span[0].len) ? n : span[0].len;                                \
+    memcpy(span[0].ptr, items, n0 * sizeof(T));                                     \
+    if(n > n0) memcpy(span[1].ptr, items + n0, (n - n0) * sizeof(T));               \
+    name##WriteCommit(cb, n);                                                       \
+    return n;                                                                       \
+}                                                                                   \
+static inline size_t name##PopN(name##_t * cb, T * out, size_t n){                  \
+    name##_span_t span[2];                                                          \
+    size_t avail = name##PeekSpans(cb, span);                                       \
+    if(n > avail) n = avail;                                                        \
+    size_t n0 = (n < span[0].len) ? n : span[0].len;                                \
+    memcpy(out, span[0].ptr, n0 * sizeof(T));                                       \
+    if(n > n0) memcpy(out + n0, span[1].ptr, (n - n0) * sizeof(T));                 \
+    name##ReadCommit(cb, n);                                                        \
+    return n;                                                                       \
+}                                                                                   \
+static inline bool name##Push(name##_t * cb, const T * item){                       \
+    return name##PushN(cb, item, 1) == 1;                                           \
+}                                                                                   \
+static inline bool name##Pop(name##_t * cb, T * out){                               \
+    return name##PopN(cb, out, 1) == 1;                                             \
+}
+
+
+/*
+    MPMC: bounded multi-producer / multi-consumer queue of fixed size elements
+    (Vyukov). Every slot carries a sequence number telling whose turn it is,
+    so producers and consumers only contend on one CAS over their own index.
+    Memory comes from the caller, CB_MPMC_MEM_SZ(count, elem_sz) bytes,
+    aligned to size_t.
+*/
+#ifdef CB_HAS_ATOMICS
+#define CB_MPMC_SLOT_SZ(elem_sz) \
+    (((sizeof(size_t) + (elem_sz)) + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t))
+#define CB_MPMC_MEM_SZ(count, elem_sz) ((count) * CB_MPMC_SLOT_SZ(elem_sz))
+
+typedef struct
+{
+    uint8_t *slots;
+    size_t slot_sz;
+    size_t elem_sz;
+    size_t size;
+    size_t mask;
+    const char *name;
+
+    alignas(CB_CACHELINE_SZ) _Atomic size_t enq;
+    alignas(CB_CACHELINE_SZ) _Atomic size_t deq;
+} cb_mpmc_t;
+
+void CbMpmcInit(cb_mpmc_t * q, void * mem, size_t count, size_t elem_sz, const char *name);
+bool CbMpmcPush(cb_mpmc_t * q, const void * item);
+bool CbMpmcPop(cb_mpmc_t * q, void * out);
+size_t CbMpmcPushN(cb_mpmc_t * q, const void * items, size_t n);
+size_t CbMpmcPopN(cb_mpmc_t * q, void * out, size_t n);
+
+
+/*
+    Broadcast: one producer, N readers with independent cursors over the
+    same bytes (Disruptor style). With gate the producer is held back by the
+    slowest active reader and refuses writes that do not fit. Without it the
+    producer pushes laggards forward before overwriting and adds the skipped
+    bytes to their lost counter; a reader that was pushed while copying finds
+    out on its commit CAS and discards what it copied (that overlapping copy is
+    deliberate, race detectors will flag it).
+    Reader slots come from the caller.
+*/
+typedef struct
+{
+    alignas(CB_CACHELINE_SZ) _Atomic size_t pos;
+    _Atomic size_t lost; // total bytes skipped by overruns
+    _Atomic bool active;
+    size_t peek_pos;     // reader private: cursor seen by CbBcastPeekSpans
+    size_t next;         // reader private: end of the last commit
+}cb_reader_t;
+
+typedef struct
+{
+    uint8_t *data;
+    size_t size;
+    size_t mask;
+    const char *name;
+    cb_reader_t *rd;
+    size_t n_readers;
+    bool gate;
+
+    alignas(CB_CACHELINE_SZ) _Atomic size_t write;
+    size_t full_cnt;
+    size_t dropped;
+}cb_bcast_t;
+
+void CbBcastInit(cb_bcast_t * bc, uint8_t * data, size_t size, cb_reader_t * readers,
+                 size_t n_readers, bool gate, const char *name);
+size_t CbBcastWrite(cb_bcast_t * bc, const uint8_t * item, size_t n);
+size_t CbBcastRead(cb_bcast_t * bc, size_t id, uint8_t * out, size_t n, size_t * lost);
+size_t CbBcastPeekSpans(cb_bcast_t * bc, size_t id, cb_span_t span[2]);
+bool CbBcastCommit(cb_bcast_t * bc, size_t id, size_t n);
+size_t CbBcastDataCount(cb_bcast_t * bc, size_t id);
+void CbBcastAttach(cb_bcast_t * bc, size_t id);
+void CbBcastDetach(cb_bcast_t * bc, size_t id);
+#endif // CB_HAS_ATOMICS
+
 #ifdef CBUFFER_IMP
 
 
@@ -68,6 +712,12 @@ static inline uint8_t CbCheckSize(size_t size){
 }
 
 
+// Ring memory, also for process-shared rings where data is an offset
+static inline uint8_t * CbMem(cb_t * cb){
+    return cb->data ? cb->data : (uint8_t *)cb + cb->data_off;
+}
+
+
 /// @brief Initialize an cicurlar buffer 
 /// @param data real data memory
 /// @param size 
@@ -77,172 +727,1714 @@ void CbInit(cb_t* cb, uint8_t * data, size_t size, const char *name){
     CB_ASSERT(cb != NULL && data != NULL && size != 0 && CbCheckSize(size));
     if(!name) name = "";
     *cb = (cb_t){ .data=data, .size=size, .mask=size-1, .write=0, .read=0,
-                  .name=name, .read_last=0, .dma_cnt=0, .full_cnt=0 };
+                  .name=name, .mirrored=false, .ntf=NULL, .policy=CB_POLICY_OVERWRITE,
+                  .read_last=0, .dma_cnt=0, .full_cnt=0 };
 }
 
 
+#ifdef CB_HAS_MIRRORED
+/// @brief Initialize a circular buffer whose memory is one memfd mapped twice,
+/// so any range of up to size bytes starting inside it is contiguous.
+/// The compiler does not know both halves alias: touching the same byte
+/// through both views inside one function needs a volatile access.
+/// @param cb 
+/// @param size power of 2 and multiple of the page size
+/// @param name 
+/// @return false if the mapping could not be created
+bool CbInitMirrored(cb_t * cb, size_t size, const char *name){
+    CB_ASSERT(cb != NULL && size != 0 && CbCheckSize(size));
+    long page = sysconf(_SC_PAGESIZE);
+    if(page <= 0 || (size % (size_t)page) != 0) return false;
 
+    int fd = (int)syscall(SYS_memfd_create, name ? name : "cb_mirror", 0u);
+    if(fd < 0) return false;
+    if(ftruncate(fd, (off_t)size) != 0){ close(fd); return false; }
 
-static inline bool CbIsEmpty(cb_t * cb){
-    return (cb->write & cb->mask) == (cb->read & cb->mask);
+    // reserve 2*size of address space, then map the file over both halves
+    uint8_t *base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED){ close(fd); return false; }
+    void *lo = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void *hi = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+    if(lo == MAP_FAILED || hi == MAP_FAILED){
+        munmap(base, 2 * size);
+        return false;
+    }
+
+    CbInit(cb, base, size, name);
+    cb->mirrored = true;
+    return true;
 }
 
-static inline bool CbIsFull(cb_t * cb){
-    return ((cb->read + 1) & cb->mask) == (cb->write & cb->mask);
+void CbFreeMirrored(cb_t * cb){
+    if(!cb || !cb->mirrored || !cb->data) return;
+    munmap(cb->data, 2 * cb->size);
+    cb->data = NULL;
+    cb->mirrored = false;
 }
+#endif // CB_HAS_MIRRORED
 
-static inline size_t CbDataCount(cb_t * cb){
-    return ((cb->write - cb->read) & cb->mask);
 
+#ifdef CB_HAS_SHARED
+// Maps header + memory, then the memory a second time right after it
+static cb_shm_t * CbShmMap(int fd, size_t data_off, size_t size){
+    uint8_t *base = mmap(NULL, data_off + 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) return NULL;
+    void *lo = mmap(base, data_off + size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void *hi = mmap(base + data_off + size, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, (off_t)data_off);
+    if(lo == MAP_FAILED || hi == MAP_FAILED){
+        munmap(base, data_off + 2 * size);
+        return NULL;
+    }
+    return (cb_shm_t *)base;
 }
 
-static inline size_t CbContiguousDataCount(cb_t * cb){
-    int aux = (int)(cb->write & cb->mask) - (cb->read & cb->mask);
-    if(aux < 0){ // read after write
-        return cb->size - (cb->read & cb->mask);
-    }else{
-        return CbDataCount(cb);
+static void CbShmBuild(cb_shm_t * shm, const char *name, size_t data_off, size_t size){
+    atomic_store_explicit(&shm->ready, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->creator, (int32_t)getpid(), memory_order_relaxed);
+    shm->magic = CB_SHM_MAGIC;
+    shm->version = CB_SHM_VERSION;
+    shm->hdr_sz = (uint32_t)sizeof(cb_shm_t);
+    atomic_store_explicit(&shm->attach_cnt, 0, memory_order_relaxed);
+    shm->size = size;
+    shm->data_off = data_off;
+    strncpy(shm->name, name, sizeof shm->name - 1);
+    shm->name[sizeof shm->name - 1] = '\0';
+
+    cb_t *cb = &shm->cb;
+    CbInit(cb, (uint8_t *)shm + data_off, size, NULL);
+    cb->data = NULL;
+    cb->data_off = data_off - offsetof(cb_shm_t, cb);
+    cb->name = NULL;
+    cb->mirrored = true;
+    atomic_store_explicit(&shm->ready, 1, memory_order_release);
+}
+
+// Header consistency, plus repair of what a crashed peer can leave behind
+static bool CbShmCheck(cb_shm_t * shm, size_t data_off, size_t size){
+    if(shm->magic != CB_SHM_MAGIC || shm->version != CB_SHM_VERSION ||
+       shm->hdr_sz != sizeof(cb_shm_t) || shm->size != size || shm->data_off != data_off){
+        return false;
+    }
+    cb_t *cb = &shm->cb;
+    if(cb->size != size || cb->mask != size - 1 || cb->data != NULL ||
+       cb->data_off != data_off - offsetof(cb_shm_t, cb)){
+        return false;
+    }
+    cb->ntf = NULL; // process local pointers from a previous user
+    cb->ts = NULL;
+    cb->wm = NULL;
+    size_t w = CB_LOAD_ACQ(cb->write);
+    size_t r = CB_LOAD_ACQ(cb->read);
+    if((intptr_t)(w - r) < 0){
+        // reader ahead of the writer: nothing valid to read, restart empty
+        CB_STORE_REL(cb->read, w);
+        cb->read_last = w;
     }
+    atomic_fetch_add_explicit(&shm->attach_cnt, 1, memory_order_relaxed);
+    return true;
 }
 
-static inline size_t CbEmptyCount(cb_t * cb){
-    return (cb->mask - ((cb->write - cb->read) & cb->mask));
+static size_t CbShmDataOff(void){
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (sizeof(cb_shm_t) + page - 1) / page * page;
 }
 
-static inline size_t CbContiguousEmptyCount(cb_t * cb){
-    size_t w = cb->write & cb->mask, r = cb->read & cb->mask;
-    if (w < r) {
-        return (r - w - 1);
-    } else {
-        size_t end = cb->size - w;
-        return (r == 0) ? (end - 1) : end;
+/// @brief Creates the shared ring `name` (POSIX shm name, "/dma0"), or
+/// reattaches to it if it already exists with the same size
+/// @param name 
+/// @param size power of 2 and multiple of the page size
+/// @return the ring, NULL on error, size mismatch or if another live process
+/// is still creating it
+cb_t * CbCreateShared(const char *name, size_t size){
+    CB_ASSERT(name != NULL && size != 0 && CbCheckSize(size));
+    long page = sysconf(_SC_PAGESIZE);
+    if(page <= 0 || (size % (size_t)page) != 0) return NULL;
+    size_t data_off = CbShmDataOff();
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    bool fresh = (fd >= 0);
+    if(!fresh){
+        if(errno != EEXIST) return NULL;
+        fd = shm_open(name, O_RDWR, 0600);
+        if(fd < 0) return NULL;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t)st.st_size != data_off + size){
+            close(fd);
+            return NULL;
+        }
+    }else if(ftruncate(fd, (off_t)(data_off + size)) != 0){
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    cb_shm_t *shm = CbShmMap(fd, data_off, size);
+    close(fd);
+    if(!shm){
+        if(fresh) shm_unlink(name);
+        return NULL;
+    }
+
+    if(!fresh && !atomic_load_explicit(&shm->ready, memory_order_acquire)){
+        // half built: take it over only if its creator is gone
+        pid_t pid = (pid_t)atomic_load_explicit(&shm->creator, memory_order_relaxed);
+        if(pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH)){
+            munmap(shm, data_off + 2 * size);
+            return NULL;
+        }
+        fresh = true;
     }
+    if(fresh) CbShmBuild(shm, name, data_off, size);
+    if(!CbShmCheck(shm, data_off, size)){
+        munmap(shm, data_off + 2 * size);
+        return NULL;
+    }
+    return &shm->cb;
 }
 
-static inline void CbWriteInc(cb_t * cb, size_t num){
-    size_t gap = CbEmptyCount(cb);
-    cb->write += num;
-    if(num > gap){
-        cb->read = cb->write + 1;
-        cb->read_last = cb->read;
-        cb->full_cnt++;
+/// @brief Attaches to a ring made by CbCreateShared in this or another process
+/// @param name 
+/// @return the ring, NULL if it does not exist, is not ready or is incompatible
+cb_t * CbOpenShared(const char *name){
+    CB_ASSERT(name != NULL);
+    size_t data_off = CbShmDataOff();
+    int fd = shm_open(name, O_RDWR, 0600);
+    if(fd < 0) return NULL;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size <= data_off){
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size - data_off;
+    cb_shm_t *shm = CbCheckSize(size) ? CbShmMap(fd, data_off, size) : NULL;
+    close(fd);
+    if(!shm) return NULL;
+    if(!atomic_load_explicit(&shm->ready, memory_order_acquire) || !CbShmCheck(shm, data_off, size)){
+        munmap(shm, data_off + 2 * size);
+        return NULL;
     }
+    return &shm->cb;
 }
 
-static inline void CbReadInc(cb_t * cb, size_t num){
-    size_t avail = (cb->write - cb->read) & cb->mask;
-    if (num > avail) num = avail;
-    cb->read += num;
-    cb->read_last = cb->read;
+/// @brief Unmaps a shared ring in this process, the segment stays
+void CbCloseShared(cb_t * cb){
+    if(!cb || cb->data) return;
+    cb_shm_t *shm = (cb_shm_t *)((uint8_t *)cb - offsetof(cb_shm_t, cb));
+    munmap(shm, shm->data_off + 2 * shm->size);
 }
 
+/// @brief Removes the segment name, mapped rings keep working until closed
+bool CbUnlinkShared(const char *name){
+    CB_ASSERT(name != NULL);
+    return shm_unlink(name) == 0;
+}
+#endif // CB_HAS_SHARED
 
-/// @brief Write a single item or a set of items in the buffer 
-/// @param cb 
-/// @param item 
-/// @param n 
-/// @return 
-size_t CbWrite(cb_t * cb, const uint8_t * item, size_t n){
-    CB_ASSERT((cb != NULL && item != NULL && n > 0));
 
-    if(n == 1){
-        cb->data[cb->write & cb->mask] = *item;
-        cb->write++;
-        if((cb->write & cb->mask) == (cb->read & cb->mask)){
-            cb->read++;
-            cb->read_last = cb->read;
-            cb->full_cnt++; // high number implies that generator is faster than consumer
-        }
-        return 1;
-    }else{
-        if(n < cb->size){
-            size_t v_write = cb->write;
-            size_t bytes_wr = 0;
-            while(bytes_wr < n){
-                cb->data[v_write & cb->mask] = item[bytes_wr];
-                bytes_wr++;
-                v_write++;
-            }
-            CbWriteInc(cb, n);
-            return n;
-        }else{
-            return 0;
-        }
+#ifdef CB_HAS_WAIT
+static inline void CbFutexWake(_Atomic uint32_t * seq){
+    atomic_fetch_add_explicit(seq, 1, memory_order_release);
+    syscall(SYS_futex, (void *)seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
 
+// Producer side, data count went from before to after
+static inline void CbNotifyData(cb_t * cb, size_t before, size_t after){
+    cb_notify_t *n = cb->ntf;
+    atomic_thread_fence(memory_order_seq_cst); // pairs with the waiter storing rd_need
+    size_t need = atomic_load_explicit(&n->rd_need, memory_order_relaxed);
+    if(need && before < need && after >= need){
+        CbFutexWake(&n->rd_seq);
+    }
+    if(n->evfd >= 0 && ((before == 0 && after > 0) ||
+                        (n->high_wm && before < n->high_wm && after >= n->high_wm))){
+        uint64_t one = 1;
+        ssize_t rc = write(n->evfd, &one, sizeof one);
+        (void)rc;
     }
 }
 
-/// @brief 
-/// @param cb 
-/// @param out 
-/// @param n 
-/// @return 
-size_t CbRead(cb_t * cb, uint8_t * out, size_t n){
-    CB_ASSERT((cb != NULL && out != NULL && n > 0));
+// Consumer side, free count went from before to after
+static inline void CbNotifySpace(cb_t * cb, size_t before, size_t after){
+    cb_notify_t *n = cb->ntf;
+    atomic_thread_fence(memory_order_seq_cst);
+    size_t need = atomic_load_explicit(&n->wr_need, memory_order_relaxed);
+    if(need && before < need && after >= need){
+        CbFutexWake(&n->wr_seq);
+    }
+}
+#endif // CB_HAS_WAIT
 
-    if(CbIsEmpty(cb)){return 0;}
-    if (n == 1){
-        *out = cb->data[cb->read & cb->mask];
-        cb->read++;
-        cb->read_last = cb->read;
-        return 1;
-    }else{
-        size_t available_bytes = CbDataCount(cb);
-        if(available_bytes < n){n = available_bytes;}
-
-        size_t v_read = cb->read;
-        size_t bytes_rd = 0;
-        while(bytes_rd < n){
-            out[bytes_rd++] = cb->data[v_read & cb->mask];
-            v_read++;
-        }
 
-        CbReadInc(cb, n);
-        return n;
+// Bytes between r and w. In SPSC mode the indices are free running and a
+// difference above mask means the DMA lapped the reader.
+static inline size_t CbCount(cb_t * cb, size_t w, size_t r){
+#ifdef CB_SPSC
+    size_t d = w - r;
+    return (d > cb->mask) ? cb->mask : d;
+#else
+    return (w - r) & cb->mask;
+#endif
+}
 
+// Consumer view of the readable bytes. On an SPSC overrun the reader jumps
+// to the newest mask bytes, the producer never touches read.
+// With CB_IDX_CACHE write is only reloaded if the cached copy shows less
+// than want bytes.
+static inline size_t CbReadAvailFor(cb_t * cb, size_t * r_out, size_t want){
+    size_t r = CB_LOAD_RLX(cb->read);
+#ifdef CB_IDX_CACHE
+    size_t w = cb->write_cache;
+    if(w - r < want || w - r > cb->mask){ // short, lapped, or indices moved under us
+        w = CB_LOAD_ACQ(cb->write);
+        cb->write_cache = w;
+    }
+#else
+    UNUSED_VAR(want);
+    size_t w = CB_LOAD_ACQ(cb->write);
+#endif
+#ifdef CB_SPSC
+    if ((w - r) > cb->mask){
+        r = w - cb->mask;
+        CB_STORE_REL(cb->read, r);
+        cb->read_last = r;
     }
+#endif
+    *r_out = r;
+    return CbCount(cb, w, r);
 }
 
+static inline size_t CbReadAvail(cb_t * cb, size_t * r_out){
+    return CbReadAvailFor(cb, r_out, SIZE_MAX);
+}
 
-size_t CbReadUntil(cb_t * cb, uint8_t * out, size_t max, uint8_t byte){
-    CB_ASSERT(cb && out && max > 0);
-    if (CbIsEmpty(cb)) return 0;
+static inline bool CbIsEmpty(cb_t * cb){
+    return CbCount(cb, CB_LOAD_ACQ(cb->write), CB_LOAD_ACQ(cb->read)) == 0;
+}
 
-    size_t avail = (cb->write - cb->read) & cb->mask;
-    if (max > avail) max = avail;
+static inline bool CbIsFull(cb_t * cb){
+    return CbCount(cb, CB_LOAD_ACQ(cb->write), CB_LOAD_ACQ(cb->read)) == cb->mask;
+}
 
-    size_t v = cb->read, i = 0;
-    for (; i < max; ++i, ++v){
-        out[i] = cb->data[v & cb->mask];
-        if (out[i] == byte){ i++; break; }
-    }
-    CbReadInc(cb, i);
-    return i;
+static inline size_t CbDataCount(cb_t * cb){
+    return CbCount(cb, CB_LOAD_ACQ(cb->write), CB_LOAD_ACQ(cb->read));
 }
 
+static inline size_t CbContiguousDataCount(cb_t * cb){
+    size_t r = CB_LOAD_ACQ(cb->read);
+    size_t n = CbCount(cb, CB_LOAD_ACQ(cb->write), r);
+    size_t till_end = cb->size - (r & cb->mask);
+    return (n < till_end) ? n : till_end;
+}
 
-// DMA utils
+static inline size_t CbEmptyCount(cb_t * cb){
+    return (cb->mask - CbDataCount(cb));
+}
 
+static inline size_t CbContiguousEmptyCount(cb_t * cb){
+    size_t w = CB_LOAD_ACQ(cb->write);
+    size_t n = cb->mask - CbCount(cb, w, CB_LOAD_ACQ(cb->read));
+    size_t till_end = cb->size - (w & cb->mask);
+    return (n < till_end) ? n : till_end;
+}
 
-void CbDmaSynStart(cb_t * cb, uint8_t start_B){
+// Producer view of the free bytes. With CB_IDX_CACHE read is only reloaded
+// if the cached copy shows less than want bytes of room.
+static inline size_t CbWriteAvailFor(cb_t * cb, size_t want){
+#ifdef CB_IDX_CACHE
+    size_t w = CB_LOAD_RLX(cb->write);
+    size_t gap = cb->mask - CbCount(cb, w, cb->read_cache);
+    if(gap < want){
+        cb->read_cache = CB_LOAD_ACQ(cb->read);
+        gap = cb->mask - CbCount(cb, w, cb->read_cache);
+    }
+    return gap;
+#else
+    UNUSED_VAR(want);
+    return CbEmptyCount(cb);
+#endif
+}
 
-    while(!CbIsEmpty(cb) && (cb->data[cb->read & cb->mask] != start_B)){
-        CbReadInc(cb, 1);
+#ifdef CB_HAS_TS
+// Producer: stamps the chunk starting at pos, before it is published
+static inline void CbTsPush(cb_ts_t * ts, size_t pos){
+    size_t h = CB_LOAD_RLX(ts->head);
+    if(h - CB_LOAD_ACQ(ts->tail) > ts->mask){
+        ts->merged++;
+        return;
     }
+    ts->ent[h & ts->mask] = (cb_ts_entry_t){ .pos = pos, .ns = CB_NOW_NS() };
+    CB_STORE_REL(ts->head, h + 1);
 }
 
-void CbDmaWrInc(cb_t * cb, int32_t ndtr){
-    if (ndtr < 0) ndtr = 0;
-    if ((size_t)ndtr > cb->size) ndtr = (int32_t)cb->size;
+// Consumer: drops the entries of chunks entirely before r, returns the
+// entry holding the byte at r or NULL. drained: r is the end of the
+// published data, so a chunk starting before it is complete too.
+static inline cb_ts_entry_t * CbTsAt(cb_ts_t * ts, size_t r, bool drained){
+    size_t t = CB_LOAD_RLX(ts->tail);
+    size_t h = CB_LOAD_ACQ(ts->head);
+    while(t != h && (intptr_t)(ts->ent[t & ts->mask].pos - r) < 0 &&
+          (drained || (h - t > 1 && (intptr_t)(ts->ent[(t + 1) & ts->mask].pos - r) <= 0))){
+        t++;
+    }
+    CB_STORE_REL(ts->tail, t);
+    if(t == h) return NULL;
+    cb_ts_entry_t *e = &ts->ent[t & ts->mask];
+    return ((intptr_t)(e->pos - r) <= 0) ? e : NULL;
+}
 
-    size_t produced = (cb->size - (size_t)ndtr) & cb->mask;
-    size_t delta    = (produced - cb->dma_cnt) & cb->mask;
+static inline void CbLatAdd(cb_ts_t * ts, uint64_t lat){
+    size_t b = 0;
+    while(b < CB_LAT_BUCKETS - 1 && (lat >> (b + 1)) != 0) b++;
+    ts->hist[b]++;
+    ts->lat_cnt++;
+    ts->lat_sum += lat;
+    if(lat > ts->lat_max) ts->lat_max = lat;
+}
+#endif // CB_HAS_TS
 
-    // Publica delta nuevos bytes; política overwrite centralizada en CbWriteInc
-    cb->dma_cnt = produced;
-    CbWriteInc(cb, delta);
+static inline void CbWmSignal(cb_wm_t * wm){
+#ifdef CB_HAS_WAIT
+    if(wm->evfd >= 0){
+        uint64_t one = 1;
+        ssize_t rc = write(wm->evfd, &one, sizeof one);
+        (void)rc;
+    }
+#else
+    UNUSED_VAR(wm);
+#endif
+}
+
+// Producer side, data count is now used. Each side only moves above one
+// way, a crossing that races with the other edge is caught on the next update.
+static inline void CbWmHigh(cb_t * cb, size_t used){
+    cb_wm_t *wm = cb->wm;
+    if(used < wm->cfg.high || CB_LOAD_ACQ(wm->above)) return;
+    CB_STORE_REL(wm->above, 1);
+    wm->highs++;
+    if(wm->cfg.on_high) wm->cfg.on_high(cb, wm->cfg.ctx);
+    CbWmSignal(wm);
+}
+
+// Consumer side, data count is now used
+static inline void CbWmLow(cb_t * cb, size_t used){
+    cb_wm_t *wm = cb->wm;
+    if(used > wm->cfg.low || !CB_LOAD_ACQ(wm->above)) return;
+    CB_STORE_REL(wm->above, 0);
+    wm->lows++;
+    if(wm->cfg.on_low) wm->cfg.on_low(cb, wm->cfg.ctx);
+    CbWmSignal(wm);
 }
 
+static inline void CbWriteInc(cb_t * cb, size_t num){
+    size_t w0 = CB_LOAD_RLX(cb->write);
+    bool lap = (w0 & cb->mask) + num >= cb->size;
+    // waiters and watermarks need the exact level
+    size_t gap = CbWriteAvailFor(cb, (cb->ntf || cb->wm) ? SIZE_MAX : num);
+    size_t w = w0 + num;
+#ifdef CB_HAS_TS
+    if(cb->ts && num) CbTsPush(cb->ts, w0);
+#endif
+    CB_STORE_REL(cb->write, w);
+    if(num > gap){
+#ifndef CB_SPSC
+        cb->read = w + 1;
+        cb->read_last = cb->read;
+#endif
+        CB_CNT_ADD(cb->full_cnt, 1);
+        CB_CNT_ADD(cb->dropped, num - gap);
+    }
+    size_t used = (num > gap) ? cb->mask : cb->mask - gap + num;
+#ifdef CB_IDX_CACHE
+    // from the cached read index used is an upper bound: a candidate peak is
+    // confirmed against the real one, so the reload only comes with new peaks
+    if(used > CB_LOAD_RLX(cb->max_used) && num <= gap){
+        cb->read_cache = CB_LOAD_ACQ(cb->read);
+        used = CbCount(cb, w, cb->read_cache);
+    }
+#endif
+    if(used > CB_LOAD_RLX(cb->max_used)) CB_STORE_RLX(cb->max_used, used);
+    if(lap) CB_CNT_ADD(cb->wraps, 1);
+    if(cb->wm && num) CbWmHigh(cb, used);
+#ifdef CB_HAS_WAIT
+    if(cb->ntf && num){
+        size_t before = cb->mask - gap;
+        CbNotifyData(cb, before, (num > gap) ? cb->mask : before + num);
+    }
+#endif
+}
+
+static inline void CbReadInc(cb_t * cb, size_t num){
+    size_t r;
+    size_t avail = CbReadAvailFor(cb, &r, (cb->ntf || cb->wm) ? SIZE_MAX : num);
+    if (num > avail) num = avail;
+#ifdef CB_HAS_TS
+    if(cb->ts && num){
+        cb_ts_entry_t *e = CbTsAt(cb->ts, r, false);
+        if(e) CbLatAdd(cb->ts, CB_NOW_NS() - e->ns);
+        CbTsAt(cb->ts, r + num, num == avail);
+    }
+#endif
+    CB_STORE_REL(cb->read, r + num);
+    cb->read_last = r + num;
+    if(cb->wm && num) CbWmLow(cb, avail - num);
+#ifdef CB_HAS_WAIT
+    if(cb->ntf && num){
+        size_t before = cb->mask - avail;
+        CbNotifySpace(cb, before, before + num);
+    }
+#endif
+}
+
+
+#ifdef CB_HAS_WAIT
+/// @brief Attaches a wait/notify block, use as CbNotifyInit(cb, ntf, 0) or
+/// CbNotifyInit(cb, ntf, .high_wm = 1024, .eventfd = true)
+/// @param cb 
+/// @param ntf caller memory, must outlive the buffer use
+/// @return false if the eventfd could not be created
+bool cb_notify_init__opt(cb_t * cb, cb_notify_t * ntf, cb_notify_opt_t opt){
+    CB_ASSERT(cb != NULL && ntf != NULL && cb->data != NULL); // not on shared rings
+    atomic_init(&ntf->rd_seq, 0);
+    atomic_init(&ntf->wr_seq, 0);
+    atomic_init(&ntf->rd_need, 0);
+    atomic_init(&ntf->wr_need, 0);
+    ntf->high_wm = opt.high_wm;
+    ntf->evfd = -1;
+    if(opt.eventfd){
+        ntf->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(ntf->evfd < 0) return false;
+    }
+    cb->ntf = ntf;
+    return true;
+}
+
+void CbNotifyClose(cb_t * cb){
+    if(!cb || !cb->ntf) return;
+    if(cb->ntf->evfd >= 0) close(cb->ntf->evfd);
+    cb->ntf->evfd = -1;
+    cb->ntf = NULL;
+}
+
+/// @brief eventfd readable on empty->non-empty and high_wm crossings, for epoll.
+/// Read it (8 bytes) to rearm.
+/// @return fd or -1 if none was requested
+int CbNotifyFd(cb_t * cb){
+    return (cb && cb->ntf) ? cb->ntf->evfd : -1;
+}
+
+// Parks on seq until level(cb) >= min or the timeout (ms, < 0 = forever) expires
+static bool CbWaitLevel(cb_t * cb, _Atomic uint32_t * seq, _Atomic size_t * need,
+                        size_t (*level)(cb_t *), size_t min, int timeout_ms){
+    if(min == 0) min = 1;
+    if(min > cb->mask) min = cb->mask;
+
+    struct timespec end = {0};
+    if(timeout_ms >= 0){
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        end.tv_sec += timeout_ms / 1000;
+        end.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if(end.tv_nsec >= 1000000000L){ end.tv_sec++; end.tv_nsec -= 1000000000L; }
+    }
+
+    for(;;){
+        uint32_t s = atomic_load_explicit(seq, memory_order_acquire);
+        atomic_store_explicit(need, min, memory_order_seq_cst);
+        if(level(cb) >= min){
+            atomic_store_explicit(need, 0, memory_order_relaxed);
+            return true;
+        }
+
+        struct timespec rel, *prel = NULL;
+        if(timeout_ms >= 0){
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            rel.tv_sec = end.tv_sec - now.tv_sec;
+            rel.tv_nsec = end.tv_nsec - now.tv_nsec;
+            if(rel.tv_nsec < 0){ rel.tv_sec--; rel.tv_nsec += 1000000000L; }
+            if(rel.tv_sec < 0){
+                atomic_store_explicit(need, 0, memory_order_relaxed);
+                return level(cb) >= min;
+            }
+            prel = &rel;
+        }
+        syscall(SYS_futex, (void *)seq, FUTEX_WAIT_PRIVATE, s, prel, NULL, 0);
+    }
+}
+
+/// @brief Blocks the consumer until at least min_bytes can be read
+/// @param cb buffer with a notify block
+/// @param min_bytes 
+/// @param timeout_ms < 0 waits forever
+/// @return false on timeout
+bool CbWaitReadable(cb_t * cb, size_t min_bytes, int timeout_ms){
+    CB_ASSERT(cb != NULL && cb->ntf != NULL);
+    return CbWaitLevel(cb, &cb->ntf->rd_seq, &cb->ntf->rd_need, CbDataCount, min_bytes, timeout_ms);
+}
+
+/// @brief Blocks the producer until at least min_bytes can be written
+/// @param cb buffer with a notify block
+/// @param min_bytes 
+/// @param timeout_ms < 0 waits forever
+/// @return false on timeout
+bool CbWaitWritable(cb_t * cb, size_t min_bytes, int timeout_ms){
+    CB_ASSERT(cb != NULL && cb->ntf != NULL);
+    return CbWaitLevel(cb, &cb->ntf->wr_seq, &cb->ntf->wr_need, CbEmptyCount, min_bytes, timeout_ms);
+}
+#endif // CB_HAS_WAIT
+
+
+// Splits n bytes starting at the free running index pos into the part that
+// fits before the end of the memory and the part that wraps to the start.
+// On a mirrored buffer the whole range is always a single span.
+static inline size_t CbSpansAt(cb_t * cb, size_t pos, size_t n, cb_span_t span[2]){
+    size_t off = pos & cb->mask;
+    size_t till_end = cb->mirrored ? n : cb->size - off;
+    uint8_t *mem = CbMem(cb);
+    span[0].ptr = &mem[off];
+    span[0].len = (n < till_end) ? n : till_end;
+    span[1].ptr = mem;
+    span[1].len = n - span[0].len;
+    return n;
+}
+
+
+/// @brief Selects what CbWrite does when the data does not fit
+/// @param cb 
+/// @param policy 
+void CbSetPolicy(cb_t * cb, cb_policy_e policy){
+    CB_ASSERT(cb != NULL);
+    cb->policy = policy;
+}
+
+/// @brief Snapshot of the buffer counters, cheap and safe from any thread
+/// @param cb 
+/// @return 
+cb_stats_t CbStats(cb_t * cb){
+    CB_ASSERT(cb != NULL);
+    return (cb_stats_t){
+        .used = CbDataCount(cb),
+        .full_cnt = CB_LOAD_RLX(cb->full_cnt),
+        .bytes_dropped = CB_LOAD_RLX(cb->dropped),
+        .high_watermark = CB_LOAD_RLX(cb->max_used),
+        .wraps = CB_LOAD_RLX(cb->wraps),
+        .read_stalls = CB_LOAD_RLX(cb->read_stalls),
+    };
+}
+
+// Applies the overflow policy to a write of n bytes, false if it is refused.
+static inline bool CbWriteAdmit(cb_t * cb, size_t n){
+    cb_policy_e policy = cb->policy;
+#ifdef CB_SPSC
+    // The producer cannot move read, so overwriting is not possible
+    if(policy == CB_POLICY_OVERWRITE) policy = CB_POLICY_DROP_NEWEST;
+#else
+    if(policy == CB_POLICY_BLOCK) policy = CB_POLICY_DROP_NEWEST;
+#endif
+    if(n < cb->size){
+        if(policy == CB_POLICY_OVERWRITE || n <= CbWriteAvailFor(cb, n)) return true;
+#ifdef CB_HAS_WAIT
+        // without a notifier there is nothing to park on: drop, do not spin
+        if(policy == CB_POLICY_BLOCK && cb->ntf) return CbWaitWritable(cb, n, -1);
+#endif
+    }
+    CB_CNT_ADD(cb->full_cnt, 1);
+    CB_CNT_ADD(cb->dropped, n);
+    return false;
+}
+
+
+/// @brief Write a single item or a set of items in the buffer 
+/// @param cb 
+/// @param item 
+/// @param n 
+/// @return 
+size_t CbWrite(cb_t * cb, const uint8_t * item, size_t n){
+    CB_ASSERT((cb != NULL && item != NULL && n > 0));
+
+    if(!CbWriteAdmit(cb, n)) return 0;
+
+    cb_span_t span[2];
+    CbSpansAt(cb, CB_LOAD_RLX(cb->write), n, span);
+    memcpy(span[0].ptr, item, span[0].len);
+    if(span[1].len) memcpy(span[1].ptr, item + span[0].len, span[1].len);
+
+    CbWriteInc(cb, n); // high full_cnt implies that generator is faster than consumer
+    return n;
+}
+
+/// @brief 
+/// @param cb 
+/// @param out 
+/// @param n 
+/// @return 
+size_t CbRead(cb_t * cb, uint8_t * out, size_t n){
+    CB_ASSERT((cb != NULL && out != NULL && n > 0));
+
+    size_t v_read;
+    size_t available_bytes = CbReadAvailFor(cb, &v_read, n);
+    if(available_bytes == 0){
+        CB_CNT_ADD(cb->read_stalls, 1);
+        return 0;
+    }
+    if(available_bytes < n){n = available_bytes;}
+
+    cb_span_t span[2];
+    CbSpansAt(cb, v_read, n, span);
+    memcpy(out, span[0].ptr, span[0].len);
+    if(span[1].len) memcpy(out + span[0].len, span[1].ptr, span[1].len);
+
+    CbReadInc(cb, n);
+    return n;
+}
+
+
+// Copies n bytes between a flat buffer and the ring range described by span,
+// starting off bytes into it. to_ring selects the direction.
+static inline void CbSpansCopy(cb_span_t span[2], size_t off, uint8_t * buf, size_t n, bool to_ring){
+    for(size_t s = 0; s < 2 && n; ++s){
+        if(off >= span[s].len){ off -= span[s].len; continue; }
+        size_t k = span[s].len - off;
+        if(k > n) k = n;
+        if(to_ring) memcpy(span[s].ptr + off, buf, k);
+        else memcpy(buf, span[s].ptr + off, k);
+        buf += k;
+        n -= k;
+        off = 0;
+    }
+}
+
+static inline size_t CbIovLen(const cb_iov_t * iov, size_t iovcnt){
+    size_t total = 0;
+    for(size_t i = 0; i < iovcnt; ++i) total += iov[i].iov_len;
+    return total;
+}
+
+/// @brief Writes several segments (header + payload...) as one record: either
+/// all of them go in, back to back, or none does. Overflow policy as CbWrite.
+/// @param cb 
+/// @param iov 
+/// @param iovcnt 
+/// @return total bytes written, 0 if refused
+size_t CbWritev(cb_t * cb, const cb_iov_t * iov, size_t iovcnt){
+    CB_ASSERT(cb != NULL && (iov != NULL || iovcnt == 0));
+    size_t total = CbIovLen(iov, iovcnt);
+    if(total == 0 || !CbWriteAdmit(cb, total)) return 0;
+
+    cb_span_t span[2];
+    CbSpansAt(cb, CB_LOAD_RLX(cb->write), total, span);
+    size_t off = 0;
+    for(size_t i = 0; i < iovcnt; ++i){
+        CbSpansCopy(span, off, (uint8_t *)iov[i].iov_base, iov[i].iov_len, true);
+        off += iov[i].iov_len;
+    }
+    CbWriteInc(cb, total);
+    return total;
+}
+
+/// @brief Fills every segment in order, only if the data for all of them is there
+/// @param cb 
+/// @param iov 
+/// @param iovcnt 
+/// @return total bytes read, 0 if not enough data (nothing consumed)
+size_t CbReadv(cb_t * cb, const cb_iov_t * iov, size_t iovcnt){
+    CB_ASSERT(cb != NULL && (iov != NULL || iovcnt == 0));
+    size_t total = CbIovLen(iov, iovcnt);
+    if(total == 0) return 0;
+
+    size_t r;
+    if(CbReadAvailFor(cb, &r, total) < total){
+        CB_CNT_ADD(cb->read_stalls, 1);
+        return 0;
+    }
+    cb_span_t span[2];
+    CbSpansAt(cb, r, total, span);
+    size_t off = 0;
+    for(size_t i = 0; i < iovcnt; ++i){
+        CbSpansCopy(span, off, (uint8_t *)iov[i].iov_base, iov[i].iov_len, false);
+        off += iov[i].iov_len;
+    }
+    CbReadInc(cb, total);
+    return total;
+}
+
+
+#ifdef CB_HAS_FDIO
+static inline int CbSpansToIov(const cb_span_t span[2], struct iovec iov[2]){
+    int cnt = 0;
+    for(int s = 0; s < 2; ++s){
+        if(!span[s].len) continue;
+        iov[cnt].iov_base = span[s].ptr;
+        iov[cnt].iov_len = span[s].len;
+        cnt++;
+    }
+    return cnt;
+}
+
+/// @brief Reads from fd (socket, pipe, uart...) straight into the free space,
+/// both sides of the wrap point in a single readv
+/// @param cb 
+/// @param fd blocking or not, EAGAIN is returned as is
+/// @return bytes received, 0 on EOF, -1 on error (ENOBUFS if the ring is full)
+ssize_t CbRecvFromFd(cb_t * cb, int fd){
+    CB_ASSERT(cb != NULL);
+    cb_span_t span[2];
+    if(CbWriteReserve(cb, span) == 0){
+        errno = ENOBUFS;
+        return -1;
+    }
+    struct iovec iov[2];
+    int cnt = CbSpansToIov(span, iov);
+    ssize_t n;
+    do{ n = readv(fd, iov, cnt); }while(n < 0 && errno == EINTR);
+    if(n > 0) CbWriteCommit(cb, (size_t)n);
+    return n;
+}
+
+/// @brief Writes the queued data to fd with a single writev. Whatever the fd
+/// did not take (partial write, EAGAIN) stays queued for the next call.
+/// @param cb 
+/// @param fd 
+/// @return bytes sent (0 if the ring was empty), -1 on error
+ssize_t CbSendToFd(cb_t * cb, int fd){
+    CB_ASSERT(cb != NULL);
+    cb_span_t span[2];
+    if(CbPeekSpans(cb, span) == 0) return 0;
+    struct iovec iov[2];
+    int cnt = CbSpansToIov(span, iov);
+    ssize_t n;
+    do{ n = writev(fd, iov, cnt); }while(n < 0 && errno == EINTR);
+    if(n > 0) CbReadCommit(cb, (size_t)n);
+    return n;
+}
+#endif // CB_HAS_FDIO
+
+
+#ifdef CB_HAS_MIRRORED
+/// @brief Attaches an overflow journal to cb, use as
+/// CbSpillInit(sp, cb, "/var/tmp/rx.journal", 1 << 26, .high_wm = 3 * cb->size / 4)
+/// @param sp 
+/// @param cb 
+/// @param path journal file, reopened with its unread data if it holds a valid one
+/// @param file_sz power of 2 and multiple of the page size
+/// @return false if the file could not be created or mapped
+bool cb_spill_init__opt(cb_spill_t * sp, cb_t * cb, const char * path, size_t file_sz, cb_spill_opt_t opt){
+    CB_ASSERT(sp != NULL && cb != NULL && path != NULL && file_sz != 0 && CbCheckSize(file_sz));
+    long page = sysconf(_SC_PAGESIZE);
+    if(page <= 0 || (file_sz % (size_t)page) != 0) return false;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(fd < 0) return false;
+    size_t map_sz = (size_t)page + file_sz;
+    struct stat st;
+    if(fstat(fd, &st) != 0){ close(fd); return false; }
+    bool reopen = ((size_t)st.st_size == map_sz);
+    if(!reopen && ftruncate(fd, (off_t)map_sz) != 0){ close(fd); return false; }
+    uint8_t *map = mmap(NULL, map_sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED){ close(fd); return false; }
+
+    *sp = (cb_spill_t){ .cb = cb, .fd = fd, .hdr = (cb_spill_hdr_t *)map, .spilling = false,
+                        .high_wm = (opt.high_wm && opt.high_wm < cb->mask) ? opt.high_wm : cb->mask };
+    CbInit(&sp->disk, map + page, file_sz, "spill");
+    CbSetPolicy(&sp->disk, CB_POLICY_DROP_NEWEST);
+
+    cb_spill_hdr_t *hdr = sp->hdr;
+    if(reopen && hdr->magic == CB_SPILL_MAGIC && hdr->size == file_sz &&
+       hdr->write < file_sz && hdr->read < file_sz){
+        // replay: the journal holds data older than anything written from now on
+        size_t r = (size_t)hdr->read;
+        size_t w = r + (size_t)((hdr->write - hdr->read) & sp->disk.mask);
+#ifndef CB_SPSC
+        w &= sp->disk.mask;
+#endif
+        CB_STORE_RLX(sp->disk.read, r);
+        CB_STORE_RLX(sp->disk.write, w);
+#ifdef CB_IDX_CACHE
+        sp->disk.read_cache = r;
+        sp->disk.write_cache = w;
+#endif
+        sp->spilling = (w != r);
+    }else{
+        // new or foreign file: invalidate before resetting, the magic goes last
+        hdr->magic = 0;
+        hdr->size = file_sz;
+        hdr->write = 0;
+        hdr->read = 0;
+        hdr->magic = CB_SPILL_MAGIC;
+    }
+    return true;
+}
+
+/// @brief CbWrite that spills to the journal instead of overwriting
+/// @param sp 
+/// @param item 
+/// @param n 
+/// @return n, or 0 if neither the ring nor the journal can take it
+size_t CbSpillWrite(cb_spill_t * sp, const uint8_t * item, size_t n){
+    CB_ASSERT(sp != NULL && item != NULL && n > 0);
+    if(sp->spilling && CbIsEmpty(&sp->disk)) sp->spilling = false; // reader caught up
+
+    if(!sp->spilling){
+        // room for n while staying under high_wm, it can only grow meanwhile
+        size_t need = n + (sp->cb->mask - sp->high_wm);
+        if(CbWriteAvailFor(sp->cb, need) >= need) return CbWrite(sp->cb, item, n);
+        sp->spilling = true;
+        sp->episodes++;
+    }
+    if(CbWrite(&sp->disk, item, n) == 0){
+        sp->refused += n;
+        return 0;
+    }
+    sp->hdr->write = CB_LOAD_RLX(sp->disk.write) & sp->disk.mask;
+    sp->spilled += n;
+    return n;
+}
+
+/// @brief CbRead that replays the journal once the ring is empty
+/// @param sp 
+/// @param out 
+/// @param n 
+/// @return bytes read
+size_t CbSpillRead(cb_spill_t * sp, uint8_t * out, size_t n){
+    CB_ASSERT(sp != NULL && out != NULL && n > 0);
+    // memory only gets new data once the journal is empty, so this keeps the order
+    if(!CbIsEmpty(sp->cb) || CbIsEmpty(&sp->disk)) return CbRead(sp->cb, out, n);
+    size_t got = CbRead(&sp->disk, out, n);
+    sp->hdr->read = CB_LOAD_RLX(sp->disk.read) & sp->disk.mask;
+    return got;
+}
+
+/// @brief Bytes waiting in the journal
+size_t CbSpillCount(cb_spill_t * sp){
+    CB_ASSERT(sp != NULL);
+    return CbDataCount(&sp->disk);
+}
+
+/// @brief Unmaps and closes the journal, unread data stays in the file for the next CbSpillInit
+void CbSpillClose(cb_spill_t * sp){
+    if(!sp || sp->fd < 0) return;
+    munmap(sp->hdr, (size_t)(sp->disk.data - (uint8_t *)sp->hdr) + sp->disk.size);
+    close(sp->fd);
+    sp->fd = -1;
+}
+#endif // CB_HAS_MIRRORED
+
+
+#ifdef CB_HAS_TS
+/// @brief Starts stamping the arrival of every chunk written to cb
+/// @param cb 
+/// @param ts 
+/// @param ent side-ring memory, at least as many entries as chunks that can be queued
+/// @param n power of 2
+/// @return false on a shared ring, the peer process cannot follow ts
+bool CbTsInit(cb_t * cb, cb_ts_t * ts, cb_ts_entry_t * ent, size_t n){
+    CB_ASSERT(cb != NULL && ts != NULL && ent != NULL && n != 0 && CbCheckSize(n));
+    if(cb->data == NULL) return false; // shared ring
+    memset(ts, 0, sizeof *ts);
+    ts->ent = ent;
+    ts->mask = n - 1;
+    cb->ts = ts;
+    return true;
+}
+
+/// @brief Arrival time of the oldest unread byte (consumer side)
+/// @param cb 
+/// @param ns CB_NOW_NS() clock
+/// @return false if the buffer is empty or that byte was never stamped
+bool CbOldestTs(cb_t * cb, uint64_t * ns){
+    CB_ASSERT(cb != NULL && cb->ts != NULL && ns != NULL);
+    size_t r;
+    if(CbReadAvail(cb, &r) == 0) return false;
+    cb_ts_entry_t *e = CbTsAt(cb->ts, r, false);
+    if(!e) return false;
+    *ns = e->ns;
+    return true;
+}
+
+/// @brief Read latency percentile from the histogram
+/// @param ts 
+/// @param pct 0..100
+/// @return upper edge of the bucket holding it in ns, 0 if nothing was read
+uint64_t CbLatPercentile(const cb_ts_t * ts, double pct){
+    CB_ASSERT(ts != NULL);
+    if(ts->lat_cnt == 0) return 0;
+    uint64_t rank = (uint64_t)((double)ts->lat_cnt * pct / 100.0);
+    if(rank >= ts->lat_cnt) rank = ts->lat_cnt - 1;
+    uint64_t acc = 0;
+    for(size_t b = 0; b < CB_LAT_BUCKETS; ++b){
+        acc += ts->hist[b];
+        if(acc > rank) return (b + 1 < CB_LAT_BUCKETS) ? (2ull << b) - 1 : UINT64_MAX;
+    }
+    return ts->lat_max;
+}
+
+/// @brief Clears the latency histogram (consumer side), the stamps are kept
+void CbLatReset(cb_ts_t * ts){
+    CB_ASSERT(ts != NULL);
+    memset(ts->hist, 0, sizeof ts->hist);
+    ts->lat_cnt = ts->lat_sum = ts->lat_max = 0;
+}
+#endif // CB_HAS_TS
+
+
+/// @brief Attaches backpressure watermarks, use as
+/// CbWatermarkInit(cb, wm, .high = 48 << 10, .low = 16 << 10, .on_high = pause, .on_low = resume)
+/// @param cb 
+/// @param wm caller memory, must outlive the buffer use
+/// @return false if the eventfd could not be created, or on a shared ring
+bool cb_wm_init__opt(cb_t * cb, cb_wm_t * wm, cb_wm_opt_t opt){
+    CB_ASSERT(cb != NULL && wm != NULL);
+    if(cb->data == NULL) return false; // shared ring
+    if(opt.high == 0 || opt.high > cb->mask) opt.high = cb->mask - cb->mask / 4;
+    if(opt.low == 0 || opt.low >= opt.high) opt.low = opt.high / 2;
+    *wm = (cb_wm_t){ .cfg = opt, .above = 0, .evfd = -1 };
+    if(opt.eventfd){
+#ifdef CB_HAS_WAIT
+        wm->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(wm->evfd < 0) return false;
+#else
+        return false;
+#endif
+    }
+    cb->wm = wm;
+    return true;
+}
+
+void CbWatermarkClose(cb_t * cb){
+    if(!cb || !cb->wm) return;
+#ifdef CB_HAS_WAIT
+    if(cb->wm->evfd >= 0) close(cb->wm->evfd);
+#endif
+    cb->wm->evfd = -1;
+    cb->wm = NULL;
+}
+
+/// @brief eventfd readable after every high or low edge, for epoll. Read it
+/// (8 bytes) to rearm and check CbAboveHigh for the direction.
+/// @return fd or -1 if none was requested
+int CbWatermarkFd(cb_t * cb){
+    return (cb && cb->wm) ? cb->wm->evfd : -1;
+}
+
+/// @brief True between a high edge and the following low edge
+bool CbAboveHigh(cb_t * cb){
+    CB_ASSERT(cb != NULL && cb->wm != NULL);
+    return CB_LOAD_ACQ(cb->wm->above) != 0;
+}
+
+
+/// @brief Exposes the unread bytes in place, without copying them
+/// @param cb 
+/// @param span span[0] up to the end of the memory, span[1] the wrapped rest (len 0 if none)
+/// @return total bytes available in both spans
+size_t CbPeekSpans(cb_t * cb, cb_span_t span[2]){
+    CB_ASSERT(cb != NULL && span != NULL);
+    size_t r;
+    size_t avail = CbReadAvail(cb, &r);
+    return CbSpansAt(cb, r, avail, span);
+}
+
+/// @brief Releases n bytes previously obtained with CbPeekSpans
+/// @param cb 
+/// @param n 
+void CbReadCommit(cb_t * cb, size_t n){
+    CB_ASSERT(cb != NULL);
+    CbReadInc(cb, n);
+}
+
+/// @brief Exposes the free space in place so the producer can fill it directly
+/// @param cb 
+/// @param span span[0] up to the end of the memory, span[1] the wrapped rest (len 0 if none)
+/// @return total free bytes in both spans
+size_t CbWriteReserve(cb_t * cb, cb_span_t span[2]){
+    CB_ASSERT(cb != NULL && span != NULL);
+    return CbSpansAt(cb, CB_LOAD_RLX(cb->write), CbEmptyCount(cb), span);
+}
+
+/// @brief Publishes n bytes written into the spans given by CbWriteReserve
+/// @param cb 
+/// @param n must not exceed the reserved space
+void CbWriteCommit(cb_t * cb, size_t n){
+    CB_ASSERT(cb != NULL && n <= CbEmptyCount(cb));
+    CbWriteInc(cb, n);
+}
+
+
+// Index of the first byte in p[0..n) or n if absent. 32/16 bytes per step
+// with AVX2/SSE2, scalar tail and fallback.
+static inline size_t CbScanByte(const uint8_t * p, size_t n, uint8_t byte){
+    size_t i = 0;
+#if !defined(CB_NO_SIMD) && defined(__AVX2__)
+    const __m256i needle32 = _mm256_set1_epi8((char)byte);
+    for (; i + 32 <= n; i += 32){
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle32));
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+#endif
+#if !defined(CB_NO_SIMD) && (defined(__AVX2__) || defined(__SSE2__))
+    const __m128i needle16 = _mm_set1_epi8((char)byte);
+    for (; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        uint32_t m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle16));
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+#endif
+    for (; i < n; ++i){
+        if (p[i] == byte) return i;
+    }
+    return n;
+}
+
+// Offset from r of the first byte within n bytes, over both spans. n if absent.
+static inline size_t CbFindAt(cb_t * cb, size_t r, size_t n, uint8_t byte){
+    cb_span_t span[2];
+    CbSpansAt(cb, r, n, span);
+    size_t off = CbScanByte(span[0].ptr, span[0].len, byte);
+    if (off < span[0].len || span[1].len == 0) return off;
+    return span[0].len + CbScanByte(span[1].ptr, span[1].len, byte);
+}
+
+/// @brief Looks for a byte in the unread data without consuming anything
+/// @param cb 
+/// @param byte 
+/// @return offset from the read position, CbDataCount if not found
+size_t CbFind(cb_t * cb, uint8_t byte){
+    CB_ASSERT(cb != NULL);
+    size_t r;
+    size_t avail = CbReadAvail(cb, &r);
+    return CbFindAt(cb, r, avail, byte);
+}
+
+size_t CbReadUntil(cb_t * cb, uint8_t * out, size_t max, uint8_t byte){
+    CB_ASSERT(cb && out && max > 0);
+
+    size_t v;
+    size_t avail = CbReadAvail(cb, &v);
+    if (avail == 0){
+        CB_CNT_ADD(cb->read_stalls, 1);
+        return 0;
+    }
+    if (max > avail) max = avail;
+
+    size_t n = CbFindAt(cb, v, max, byte);
+    n = (n < max) ? n + 1 : max; // include the delimiter
+
+    cb_span_t span[2];
+    CbSpansAt(cb, v, n, span);
+    memcpy(out, span[0].ptr, span[0].len);
+    if (span[1].len) memcpy(out + span[0].len, span[1].ptr, span[1].len);
+    CbReadInc(cb, n);
+    return n;
+}
+
+
+// DMA utils
+
+
+void CbDmaSynStart(cb_t * cb, uint8_t start_B){
+    size_t r;
+    size_t avail = CbReadAvail(cb, &r);
+    CbReadInc(cb, CbFindAt(cb, r, avail, start_B));
+}
+
+void CbDmaWrInc(cb_t * cb, int32_t ndtr){
+    if (ndtr < 0) ndtr = 0;
+    if ((size_t)ndtr > cb->size) ndtr = (int32_t)cb->size;
+
+    size_t produced = (cb->size - (size_t)ndtr) & cb->mask;
+    size_t delta    = (produced - cb->dma_cnt) & cb->mask;
+
+    // Publica delta nuevos bytes; política overwrite centralizada en CbWriteInc
+    cb->dma_cnt = produced;
+    CbWriteInc(cb, delta);
+}
+
+
+// DMA frame decoder
+
+// Tables for CRC-16/CCITT-FALSE (poly 0x1021) and CRC-32 (reflected poly 0xEDB88320),
+// precomputed so they are read-only and safe to use from any thread without setup
+static const uint16_t cb_crc16_tab[256] = {
+    0x0000u, 0x1021u, 0x2042u, 0x3063u, 0x4084u, 0x50A5u, 0x60C6u, 0x70E7u,
+    0x8108u, 0x9129u, 0xA14Au, 0xB16Bu, 0xC18Cu, 0xD1ADu, 0xE1CEu, 0xF1EFu,
+    0x1231u, 0x0210u, 0x3273u, 0x2252u, 0x52B5u, 0x4294u, 0x72F7u, 0x62D6u,
+    0x9339u, 0x8318u, 0xB37Bu, 0xA35Au, 0xD3BDu, 0xC39Cu, 0xF3FFu, 0xE3DEu,
+    0x2462u, 0x3443u, 0x0420u, 0x1401u, 0x64E6u, 0x74C7u, 0x44A4u, 0x5485u,
+    0xA56Au, 0xB54Bu, 0x8528u, 0x9509u, 0xE5EEu, 0xF5CFu, 0xC5ACu, 0xD58Du,
+    0x3653u, 0x2672u, 0x1611u, 0x0630u, 0x76D7u, 0x66F6u, 0x5695u, 0x46B4u,
+    0xB75Bu, 0xA77Au, 0x9719u, 0x8738u, 0xF7DFu, 0xE7FEu, 0xD79Du, 0xC7BCu,
+    0x48C4u, 0x58E5u, 0x6886u, 0x78A7u, 0x0840u, 0x1861u, 0x2802u, 0x3823u,
+    0xC9CCu, 0xD9EDu, 0xE98Eu, 0xF9AFu, 0x8948u, 0x9969u, 0xA90Au, 0xB92Bu,
+    0x5AF5u, 0x4AD4u, 0x7AB7u, 0x6A96u, 0x1A71u, 0x0A50u, 0x3A33u, 0x2A12u,
+    0xDBFDu, 0xCBDCu, 0xFBBFu, 0xEB9Eu, 0x9B79u, 0x8B58u, 0xBB3Bu, 0xAB1Au,
+    0x6CA6u, 0x7C87u, 0x4CE4u, 0x5CC5u, 0x2C22u, 0x3C03u, 0x0C60u, 0x1C41u,
+    0xEDAEu, 0xFD8Fu, 0xCDECu, 0xDDCDu, 0xAD2Au, 0xBD0Bu, 0x8D68u, 0x9D49u,
+    0x7E97u, 0x6EB6u, 0x5ED5u, 0x4EF4u, 0x3E13u, 0x2E32u, 0x1E51u, 0x0E70u,
+    0xFF9Fu, 0xEFBEu, 0xDFDDu, 0xCFFCu, 0xBF1Bu, 0xAF3Au, 0x9F59u, 0x8F78u,
+    0x9188u, 0x81A9u, 0xB1CAu, 0xA1EBu, 0xD10Cu, 0xC12Du, 0xF14Eu, 0xE16Fu,
+    0x1080u, 0x00A1u, 0x30C2u, 0x20E3u, 0x5004u, 0x4025u, 0x7046u, 0x6067u,
+    0x83B9u, 0x9398u, 0xA3FBu, 0xB3DAu, 0xC33Du, 0xD31Cu, 0xE37Fu, 0xF35Eu,
+    0x02B1u, 0x1290u, 0x22F3u, 0x32D2u, 0x4235u, 0x5214u, 0x6277u, 0x7256u,
+    0xB5EAu, 0xA5CBu, 0x95A8u, 0x8589u, 0xF56Eu, 0xE54Fu, 0xD52Cu, 0xC50Du,
+    0x34E2u, 0x24C3u, 0x14A0u, 0x0481u, 0x7466u, 0x6447u, 0x5424u, 0x4405u,
+    0xA7DBu, 0xB7FAu, 0x8799u, 0x97B8u, 0xE75Fu, 0xF77Eu, 0xC71Du, 0xD73Cu,
+    0x26D3u, 0x36F2u, 0x0691u, 0x16B0u, 0x6657u, 0x7676u, 0x4615u, 0x5634u,
+    0xD94Cu, 0xC96Du, 0xF90Eu, 0xE92Fu, 0x99C8u, 0x89E9u, 0xB98Au, 0xA9ABu,
+    0x5844u, 0x4865u, 0x7806u, 0x6827u, 0x18C0u, 0x08E1u, 0x3882u, 0x28A3u,
+    0xCB7Du, 0xDB5Cu, 0xEB3Fu, 0xFB1Eu, 0x8BF9u, 0x9BD8u, 0xABBBu, 0xBB9Au,
+    0x4A75u, 0x5A54u, 0x6A37u, 0x7A16u, 0x0AF1u, 0x1AD0u, 0x2AB3u, 0x3A92u,
+    0xFD2Eu, 0xED0Fu, 0xDD6Cu, 0xCD4Du, 0xBDAAu, 0xAD8Bu, 0x9DE8u, 0x8DC9u,
+    0x7C26u, 0x6C07u, 0x5C64u, 0x4C45u, 0x3CA2u, 0x2C83u, 0x1CE0u, 0x0CC1u,
+    0xEF1Fu, 0xFF3Eu, 0xCF5Du, 0xDF7Cu, 0xAF9Bu, 0xBFBAu, 0x8FD9u, 0x9FF8u,
+    0x6E17u, 0x7E36u, 0x4E55u, 0x5E74u, 0x2E93u, 0x3EB2u, 0x0ED1u, 0x1EF0u,
+};
+
+static const uint32_t cb_crc32_tab[256] = {
+    0x00000000u, 0x77073096u, 0xEE0E612Cu, 0x990951BAu, 0x076DC419u, 0x706AF48Fu,
+    0xE963A535u, 0x9E6495A3u, 0x0EDB8832u, 0x79DCB8A4u, 0xE0D5E91Eu, 0x97D2D988u,
+    0x09B64C2Bu, 0x7EB17CBDu, 0xE7B82D07u, 0x90BF1D91u, 0x1DB71064u, 0x6AB020F2u,
+    0xF3B97148u, 0x84BE41DEu, 0x1ADAD47Du, 0x6DDDE4EBu, 0xF4D4B551u, 0x83D385C7u,
+    0x136C9856u, 0x646BA8C0u, 0xFD62F97Au, 0x8A65C9ECu, 0x14015C4Fu, 0x63066CD9u,
+    0xFA0F3D63u, 0x8D080DF5u, 0x3B6E20C8u, 0x4C69105Eu, 0xD56041E4u, 0xA2677172u,
+    0x3C03E4D1u, 0x4B04D447u, 0xD20D85FDu, 0xA50AB56Bu, 0x35B5A8FAu, 0x42B2986Cu,
+    0xDBBBC9D6u, 0xACBCF940u, 0x32D86CE3u, 0x45DF5C75u, 0xDCD60DCFu, 0xABD13D59u,
+    0x26D930ACu, 0x51DE003Au, 0xC8D75180u, 0xBFD06116u, 0x21B4F4B5u, 0x56B3C423u,
+    0xCFBA9599u, 0xB8BDA50Fu, 0x2802B89Eu, 0x5F058808u, 0xC60CD9B2u, 0xB10BE924u,
+    0x2F6F7C87u, 0x58684C11u, 0xC1611DABu, 0xB6662D3Du, 0x76DC4190u, 0x01DB7106u,
+    0x98D220BCu, 0xEFD5102Au, 0x71B18589u, 0x06B6B51Fu, 0x9FBFE4A5u, 0xE8B8D433u,
+    0x7807C9A2u, 0x0F00F934u, 0x9609A88Eu, 0xE10E9818u, 0x7F6A0DBBu, 0x086D3D2Du,
+    0x91646C97u, 0xE6635C01u, 0x6B6B51F4u, 0x1C6C6162u, 0x856530D8u, 0xF262004Eu,
+    0x6C0695EDu, 0x1B01A57Bu, 0x8208F4C1u, 0xF50FC457u, 0x65B0D9C6u, 0x12B7E950u,
+    0x8BBEB8EAu, 0xFCB9887Cu, 0x62DD1DDFu, 0x15DA2D49u, 0x8CD37CF3u, 0xFBD44C65u,
+    0x4DB26158u, 0x3AB551CEu, 0xA3BC0074u, 0xD4BB30E2u, 0x4ADFA541u, 0x3DD895D7u,
+    0xA4D1C46Du, 0xD3D6F4FBu, 0x4369E96Au, 0x346ED9FCu, 0xAD678846u, 0xDA60B8D0u,
+    0x44042D73u, 0x33031DE5u, 0xAA0A4C5Fu, 0xDD0D7CC9u, 0x5005713Cu, 0x270241AAu,
+    0xBE0B1010u, 0xC90C2086u, 0x5768B525u, 0x206F85B3u, 0xB966D409u, 0xCE61E49Fu,
+    0x5EDEF90Eu, 0x29D9C998u, 0xB0D09822u, 0xC7D7A8B4u, 0x59B33D17u, 0x2EB40D81u,
+    0xB7BD5C3Bu, 0xC0BA6CADu, 0xEDB88320u, 0x9ABFB3B6u, 0x03B6E20Cu, 0x74B1D29Au,
+    0xEAD54739u, 0x9DD277AFu, 0x04DB2615u, 0x73DC1683u, 0xE3630B12u, 0x94643B84u,
+    0x0D6D6A3Eu, 0x7A6A5AA8u, 0xE40ECF0Bu, 0x9309FF9Du, 0x0A00AE27u, 0x7D079EB1u,
+    0xF00F9344u, 0x8708A3D2u, 0x1E01F268u, 0x6906C2FEu, 0xF762575Du, 0x806567CBu,
+    0x196C3671u, 0x6E6B06E7u, 0xFED41B76u, 0x89D32BE0u, 0x10DA7A5Au, 0x67DD4ACCu,
+    0xF9B9DF6Fu, 0x8EBEEFF9u, 0x17B7BE43u, 0x60B08ED5u, 0xD6D6A3E8u, 0xA1D1937Eu,
+    0x38D8C2C4u, 0x4FDFF252u, 0xD1BB67F1u, 0xA6BC5767u, 0x3FB506DDu, 0x48B2364Bu,
+    0xD80D2BDAu, 0xAF0A1B4Cu, 0x36034AF6u, 0x41047A60u, 0xDF60EFC3u, 0xA867DF55u,
+    0x316E8EEFu, 0x4669BE79u, 0xCB61B38Cu, 0xBC66831Au, 0x256FD2A0u, 0x5268E236u,
+    0xCC0C7795u, 0xBB0B4703u, 0x220216B9u, 0x5505262Fu, 0xC5BA3BBEu, 0xB2BD0B28u,
+    0x2BB45A92u, 0x5CB36A04u, 0xC2D7FFA7u, 0xB5D0CF31u, 0x2CD99E8Bu, 0x5BDEAE1Du,
+    0x9B64C2B0u, 0xEC63F226u, 0x756AA39Cu, 0x026D930Au, 0x9C0906A9u, 0xEB0E363Fu,
+    0x72076785u, 0x05005713u, 0x95BF4A82u, 0xE2B87A14u, 0x7BB12BAEu, 0x0CB61B38u,
+    0x92D28E9Bu, 0xE5D5BE0Du, 0x7CDCEFB7u, 0x0BDBDF21u, 0x86D3D2D4u, 0xF1D4E242u,
+    0x68DDB3F8u, 0x1FDA836Eu, 0x81BE16CDu, 0xF6B9265Bu, 0x6FB077E1u, 0x18B74777u,
+    0x88085AE6u, 0xFF0F6A70u, 0x66063BCAu, 0x11010B5Cu, 0x8F659EFFu, 0xF862AE69u,
+    0x616BFFD3u, 0x166CCF45u, 0xA00AE278u, 0xD70DD2EEu, 0x4E048354u, 0x3903B3C2u,
+    0xA7672661u, 0xD06016F7u, 0x4969474Du, 0x3E6E77DBu, 0xAED16A4Au, 0xD9D65ADCu,
+    0x40DF0B66u, 0x37D83BF0u, 0xA9BCAE53u, 0xDEBB9EC5u, 0x47B2CF7Fu, 0x30B5FFE9u,
+    0xBDBDF21Cu, 0xCABAC28Au, 0x53B39330u, 0x24B4A3A6u, 0xBAD03605u, 0xCDD70693u,
+    0x54DE5729u, 0x23D967BFu, 0xB3667A2Eu, 0xC4614AB8u, 0x5D681B02u, 0x2A6F2B94u,
+    0xB40BBE37u, 0xC30C8EA1u, 0x5A05DF1Bu, 0x2D02EF8Du,
+};
+
+/// @brief CRC-16/CCITT-FALSE, start with crc = 0xFFFF
+uint16_t CbCrc16(uint16_t crc, const uint8_t * p, size_t n){
+    for(size_t i = 0; i < n; ++i){
+        crc = (uint16_t)((crc << 8) ^ cb_crc16_tab[(uint8_t)((crc >> 8) ^ p[i])]);
+    }
+    return crc;
+}
+
+/// @brief CRC-32 (zlib), start with crc = 0 and chain the returned value
+uint32_t CbCrc32(uint32_t crc, const uint8_t * p, size_t n){
+    crc = ~crc;
+    for(size_t i = 0; i < n; ++i){
+        crc = (crc >> 8) ^ cb_crc32_tab[(uint8_t)(crc ^ p[i])];
+    }
+    return ~crc;
+}
+
+/// @brief Initialize a frame decoder reading from cb, use as
+/// CbFrameInit(&dec, &cb, .sync = 0xAA55, .sync_len = 2, .len_off = 2, .len_sz = 2, .crc = CB_CRC16_CCITT)
+void cb_frame_init__opt(cb_frame_dec_t * dec, cb_t * cb, cb_frame_cfg_t cfg){
+    CB_ASSERT(dec != NULL && cb != NULL);
+    CB_ASSERT(cfg.sync_len >= 1 && cfg.sync_len <= 4);
+    CB_ASSERT((cfg.len_sz == 1 || cfg.len_sz == 2) && cfg.len_off >= cfg.sync_len);
+    *dec = (cb_frame_dec_t){ .cb = cb, .cfg = cfg };
+    dec->hdr_sz = (size_t)cfg.len_off + cfg.len_sz;
+    dec->crc_sz = (cfg.crc == CB_CRC16_CCITT) ? 2 : (cfg.crc == CB_CRC32) ? 4 : 0;
+    if(dec->cfg.max_payload == 0 || dec->cfg.max_payload > cb->mask){
+        dec->cfg.max_payload = cb->mask;
+    }
+}
+
+// Big or little endian value of n bytes at offset off from the read index r
+static inline uint32_t CbFrameField(cb_t * cb, size_t r, size_t off, size_t n, bool le){
+    uint32_t v = 0;
+    for(size_t i = 0; i < n; ++i){
+        uint32_t b = CbMem(cb)[(r + off + i) & cb->mask];
+        v = le ? (v | (b << (8 * i))) : ((v << 8) | b);
+    }
+    return v;
+}
+
+static uint32_t CbFrameCrc(cb_frame_dec_t * dec, size_t r, size_t n){
+    cb_span_t span[2];
+    CbSpansAt(dec->cb, r + dec->cfg.sync_len, n, span);
+    if(dec->cfg.crc == CB_CRC16_CCITT){
+        uint16_t c = CbCrc16(0xFFFFu, span[0].ptr, span[0].len);
+        return CbCrc16(c, span[1].ptr, span[1].len);
+    }
+    uint32_t c = CbCrc32(0, span[0].ptr, span[0].len);
+    return CbCrc32(c, span[1].ptr, span[1].len);
+}
+
+// Drops bytes before the next sync word candidate, counting the resync
+static inline void CbFrameHunt(cb_frame_dec_t * dec, size_t drop){
+    cb_t *cb = dec->cb;
+    uint8_t first = (uint8_t)(dec->cfg.sync >> (8 * (dec->cfg.sync_len - 1)));
+    size_t before = CbDataCount(cb);
+    CbReadInc(cb, drop);
+    CbDmaSynStart(cb, first);
+    dec->skipped += before - CbDataCount(cb);
+    dec->resyncs++;
+}
+
+/// @brief Extracts the next validated frame, zero copy
+/// @param dec 
+/// @param frame spans into the ring, valid until CbFrameRelease or the next call
+/// @return false if no complete frame is available yet
+bool CbFrameNext(cb_frame_dec_t * dec, cb_frame_t * frame){
+    CB_ASSERT(dec != NULL && frame != NULL);
+    cb_t *cb = dec->cb;
+    const cb_frame_cfg_t *cfg = &dec->cfg;
+    CbFrameRelease(dec);
+
+    for(;;){
+        size_t r;
+        size_t avail = CbReadAvail(cb, &r);
+        if(avail < cfg->sync_len) return false;
+
+        if(CbFrameField(cb, r, 0, cfg->sync_len, false) != cfg->sync){
+            CbFrameHunt(dec, 1);
+            continue;
+        }
+        if(avail < dec->hdr_sz) return false;
+
+        size_t len = CbFrameField(cb, r, cfg->len_off, cfg->len_sz, cfg->len_le);
+        size_t total = dec->hdr_sz + len + dec->crc_sz;
+        if(len > cfg->max_payload || total > cb->mask){
+            dec->len_errors++;
+            CbFrameHunt(dec, 1);
+            continue;
+        }
+        if(avail < total) return false;
+
+        if(dec->crc_sz){
+            size_t covered = total - cfg->sync_len - dec->crc_sz;
+            uint32_t crc = CbFrameCrc(dec, r, covered);
+            uint32_t got = CbFrameField(cb, r, total - dec->crc_sz, dec->crc_sz, cfg->crc_le);
+            if(crc != got){
+                dec->crc_errors++;
+                CbFrameHunt(dec, 1);
+                continue;
+            }
+        }
+
+        CbSpansAt(cb, r, total, frame->span);
+        frame->len = total;
+        frame->payload_off = dec->hdr_sz;
+        frame->payload_len = len;
+        dec->pending = total;
+        dec->frames++;
+        return true;
+    }
+}
+
+/// @brief Consumes the frame returned by CbFrameNext
+/// @param dec 
+void CbFrameRelease(cb_frame_dec_t * dec){
+    CB_ASSERT(dec != NULL);
+    if(dec->pending){
+        CbReadInc(dec->cb, dec->pending);
+        dec->pending = 0;
+    }
+}
+
+/// @brief Copies the payload of a frame, joining both spans
+/// @return bytes copied
+size_t CbFramePayload(const cb_frame_t * frame, uint8_t * out, size_t max){
+    CB_ASSERT(frame != NULL && out != NULL);
+    size_t n = (frame->payload_len < max) ? frame->payload_len : max;
+    size_t off = frame->payload_off, done = 0;
+    for(size_t s = 0; s < 2 && done < n; ++s){
+        if(off >= frame->span[s].len){ off -= frame->span[s].len; continue; }
+        size_t k = frame->span[s].len - off;
+        if(k > n - done) k = n - done;
+        memcpy(out + done, frame->span[s].ptr + off, k);
+        done += k;
+        off = 0;
+    }
+    return done;
+}
+
+
+// Framed messages
+
+static inline size_t CbMsgRecordSz(size_t len, bool ts){
+    size_t n = sizeof(uint32_t) + (ts ? sizeof(uint64_t) : 0) + len;
+    return (n + CB_MSG_ALIGN - 1) & ~(size_t)(CB_MSG_ALIGN - 1);
+}
+
+/// @brief Appends one record, use as CbPushMsg(cb, payload, len, 0) or
+/// CbPushMsg(cb, payload, len, .ts = stamp)
+/// @return false if the record does not fit (counted in full_cnt)
+bool cb_push_msg__opt(cb_t * cb, const void * payload, size_t len, cb_msg_opt_t opt){
+    CB_ASSERT(cb != NULL && (payload != NULL || len == 0) && cb->size >= CB_MSG_ALIGN);
+    if(len > CB_MSG_MAX_LEN) return false;
+
+    bool has_ts = (opt.ts != 0);
+    size_t rec = CbMsgRecordSz(len, has_ts);
+    size_t w = CB_LOAD_RLX(cb->write);
+    size_t off = w & cb->mask;
+    size_t pad = 0;
+    if(!cb->mirrored && rec > cb->size - off){
+        pad = cb->size - off; // record goes to the start, skip the tail
+    }
+    if(pad + rec > CbEmptyCount(cb)){
+        CB_CNT_ADD(cb->full_cnt, 1);
+        CB_CNT_ADD(cb->dropped, len);
+        return false;
+    }
+
+    if(pad){
+        uint32_t skip = CB_MSG_SKIP;
+        memcpy(&CbMem(cb)[off], &skip, sizeof skip);
+        off = 0;
+    }
+    uint8_t *p = &CbMem(cb)[off];
+    uint32_t hdr = (uint32_t)len | (has_ts ? CB_MSG_TS_FLAG : 0u);
+    memcpy(p, &hdr, sizeof hdr);
+    p += sizeof hdr;
+    if(has_ts){
+        memcpy(p, &opt.ts, sizeof opt.ts);
+        p += sizeof opt.ts;
+    }
+    if(len) memcpy(p, payload, len);
+
+    CbWriteInc(cb, pad + rec);
+    return true;
+}
+
+/// @brief Gives the oldest record in place, without consuming it
+/// @param cb 
+/// @param msg data points into the ring until CbDropMsg
+/// @return false if there is no record
+bool CbPeekMsg(cb_t * cb, cb_msg_t * msg){
+    CB_ASSERT(cb != NULL && msg != NULL);
+    for(;;){
+        size_t r;
+        if(CbReadAvail(cb, &r) == 0){
+            CB_CNT_ADD(cb->read_stalls, 1);
+            return false;
+        }
+        size_t off = r & cb->mask;
+        uint32_t hdr;
+        memcpy(&hdr, &CbMem(cb)[off], sizeof hdr);
+        if(hdr == CB_MSG_SKIP){
+            CbReadInc(cb, cb->size - off);
+            continue;
+        }
+        uint8_t *p = &CbMem(cb)[off] + sizeof hdr;
+        msg->ts = 0;
+        if(hdr & CB_MSG_TS_FLAG){
+            memcpy(&msg->ts, p, sizeof msg->ts);
+            p += sizeof msg->ts;
+        }
+        msg->len = hdr & CB_MSG_MAX_LEN;
+        msg->data = p;
+        return true;
+    }
+}
+
+/// @brief Consumes the oldest record
+/// @param cb 
+void CbDropMsg(cb_t * cb){
+    cb_msg_t msg;
+    if(!CbPeekMsg(cb, &msg)) return;
+    CbReadInc(cb, CbMsgRecordSz(msg.len, msg.ts != 0));
+}
+
+/// @brief Copies out and consumes the oldest record
+/// @param cb 
+/// @param out payload, truncated to max
+/// @param max 
+/// @param msg full length and timestamp of the record (data = out), may be NULL
+/// @return false if there is no record
+bool CbPopMsg(cb_t * cb, uint8_t * out, size_t max, cb_msg_t * msg){
+    CB_ASSERT(cb != NULL && (out != NULL || max == 0));
+    cb_msg_t m;
+    if(!CbPeekMsg(cb, &m)) return false;
+    size_t n = (m.len < max) ? m.len : max;
+    if(n) memcpy(out, m.data, n);
+    CbReadInc(cb, CbMsgRecordSz(m.len, m.ts != 0));
+    if(msg){
+        *msg = m;
+        msg->data = out;
+    }
+    return true;
+}
+
+
+// MPMC
+
+#ifdef CB_HAS_ATOMICS
+
+static inline _Atomic size_t * CbMpmcSeq(cb_mpmc_t * q, size_t pos){
+    return (_Atomic size_t *)(void *)(q->slots + (pos & q->mask) * q->slot_sz);
+}
+
+static inline uint8_t * CbMpmcElem(cb_mpmc_t * q, size_t pos){
+    return q->slots + (pos & q->mask) * q->slot_sz + sizeof(size_t);
+}
+
+/// @brief Initialize a MPMC queue over caller memory
+/// @param mem CB_MPMC_MEM_SZ(count, elem_sz) bytes
+/// @param count number of elements, power of 2
+/// @param elem_sz bytes per element
+/// @param name 
+void CbMpmcInit(cb_mpmc_t * q, void * mem, size_t count, size_t elem_sz, const char *name){
+    CB_ASSERT(q != NULL && mem != NULL && elem_sz != 0 && CbCheckSize(count));
+    CB_ASSERT(((uintptr_t)mem % sizeof(size_t)) == 0);
+    if(!name) name = "";
+    q->slots = (uint8_t *)mem;
+    q->slot_sz = CB_MPMC_SLOT_SZ(elem_sz);
+    q->elem_sz = elem_sz;
+    q->size = count;
+    q->mask = count - 1;
+    q->name = name;
+    for(size_t i = 0; i < count; ++i){
+        atomic_init(CbMpmcSeq(q, i), i);
+    }
+    atomic_init(&q->enq, 0);
+    atomic_init(&q->deq, 0);
+}
+
+// Claims up to n consecutive slots whose sequence equals pos + j + ready_off.
+// Returns how many were claimed, their first position in *first.
+static size_t CbMpmcClaim(cb_mpmc_t * q, _Atomic size_t * idx, size_t n, size_t ready_off, size_t * first){
+    size_t pos = atomic_load_explicit(idx, memory_order_relaxed);
+    for(;;){
+        size_t k = 0;
+        intptr_t dif = 0;
+        for(; k < n; ++k){
+            size_t seq = atomic_load_explicit(CbMpmcSeq(q, pos + k), memory_order_acquire);
+            dif = (intptr_t)seq - (intptr_t)(pos + k + ready_off);
+            if(dif != 0) break;
+        }
+        if(k == 0){
+            if(dif < 0) return 0; // full (push) or empty (pop)
+            pos = atomic_load_explicit(idx, memory_order_relaxed); // pos taken, retry
+            continue;
+        }
+        if(atomic_compare_exchange_weak_explicit(idx, &pos, pos + k,
+                                                 memory_order_relaxed, memory_order_relaxed)){
+            *first = pos;
+            return k;
+        }
+    }
+}
+
+/// @brief Enqueues up to n elements as one batch
+/// @return elements enqueued, 0 if the queue is full
+size_t CbMpmcPushN(cb_mpmc_t * q, const void * items, size_t n){
+    CB_ASSERT(q != NULL && items != NULL);
+    size_t pos;
+    size_t k = CbMpmcClaim(q, &q->enq, n, 0, &pos);
+    const uint8_t * src = (const uint8_t *)items;
+    for(size_t j = 0; j < k; ++j){
+        memcpy(CbMpmcElem(q, pos + j), src + j * q->elem_sz, q->elem_sz);
+        atomic_store_explicit(CbMpmcSeq(q, pos + j), pos + j + 1, memory_order_release);
+    }
+    return k;
+}
+
+/// @brief Dequeues up to n elements as one batch
+/// @return elements dequeued, 0 if the queue is empty
+size_t CbMpmcPopN(cb_mpmc_t * q, void * out, size_t n){
+    CB_ASSERT(q != NULL && out != NULL);
+    size_t pos;
+    size_t k = CbMpmcClaim(q, &q->deq, n, 1, &pos);
+    uint8_t * dst = (uint8_t *)out;
+    for(size_t j = 0; j < k; ++j){
+        memcpy(dst + j * q->elem_sz, CbMpmcElem(q, pos + j), q->elem_sz);
+        atomic_store_explicit(CbMpmcSeq(q, pos + j), pos + j + q->size, memory_order_release);
+    }
+    return k;
+}
+
+bool CbMpmcPush(cb_mpmc_t * q, const void * item){
+    return CbMpmcPushN(q, item, 1) == 1;
+}
+
+bool CbMpmcPop(cb_mpmc_t * q, void * out){
+    return CbMpmcPopN(q, out, 1) == 1;
+}
+
+
+// Broadcast
+
+/// @brief Initialize a broadcast ring, every reader starts attached at 0
+/// @param data ring memory, size power of 2
+/// @param readers caller slots, one per reader id
+/// @param gate true: never overwrite unread data, false: overrun slow readers
+void CbBcastInit(cb_bcast_t * bc, uint8_t * data, size_t size, cb_reader_t * readers,
+                 size_t n_readers, bool gate, const char *name){
+    CB_ASSERT(bc != NULL && data != NULL && CbCheckSize(size) && (readers != NULL || n_readers == 0));
+    bc->data = data;
+    bc->size = size;
+    bc->mask = size - 1;
+    bc->name = name ? name : "";
+    bc->rd = readers;
+    bc->n_readers = n_readers;
+    bc->gate = gate;
+    bc->full_cnt = 0;
+    bc->dropped = 0;
+    atomic_init(&bc->write, 0);
+    for(size_t i = 0; i < n_readers; ++i){
+        atomic_init(&readers[i].pos, 0);
+        atomic_init(&readers[i].lost, 0);
+        atomic_init(&readers[i].active, true);
+        readers[i].peek_pos = 0;
+        readers[i].next = 0;
+    }
+}
+
+static inline size_t CbBcastSpansAt(cb_bcast_t * bc, size_t pos, size_t n, cb_span_t span[2]){
+    size_t off = pos & bc->mask;
+    size_t till_end = bc->size - off;
+    span[0].ptr = &bc->data[off];
+    span[0].len = (n < till_end) ? n : till_end;
+    span[1].ptr = bc->data;
+    span[1].len = n - span[0].len;
+    return n;
+}
+
+/// @brief Publishes n bytes to every reader
+/// @return n, or 0 if a gated reader has no room (counted in full_cnt)
+size_t CbBcastWrite(cb_bcast_t * bc, const uint8_t * item, size_t n){
+    CB_ASSERT(bc != NULL && item != NULL && n > 0);
+    if(n > bc->mask){
+        bc->full_cnt++;
+        bc->dropped += n;
+        return 0;
+    }
+    size_t w = atomic_load_explicit(&bc->write, memory_order_relaxed);
+    size_t need = w + n - bc->mask; // every cursor must be at least here
+
+    for(size_t i = 0; i < bc->n_readers; ++i){
+        cb_reader_t *rd = &bc->rd[i];
+        if(!atomic_load_explicit(&rd->active, memory_order_acquire)) continue;
+        size_t p = atomic_load_explicit(&rd->pos, memory_order_acquire);
+        while((intptr_t)(need - p) > 0){
+            if(bc->gate){
+                bc->full_cnt++;
+                bc->dropped += n;
+                return 0;
+            }
+            if(atomic_compare_exchange_weak_explicit(&rd->pos, &p, need,
+                                                     memory_order_acq_rel, memory_order_acquire)){
+                atomic_fetch_add_explicit(&rd->lost, need - p, memory_order_relaxed);
+                break;
+            }
+        }
+    }
+
+    cb_span_t span[2];
+    CbBcastSpansAt(bc, w, n, span);
+    memcpy(span[0].ptr, item, span[0].len);
+    if(span[1].len) memcpy(span[1].ptr, item + span[0].len, span[1].len);
+    atomic_store_explicit(&bc->write, w + n, memory_order_release);
+    return n;
+}
+
+/// @brief Bytes reader id has not consumed yet
+size_t CbBcastDataCount(cb_bcast_t * bc, size_t id){
+    CB_ASSERT(bc != NULL && id < bc->n_readers);
+    size_t p = atomic_load_explicit(&bc->rd[id].pos, memory_order_acquire);
+    size_t n = atomic_load_explicit(&bc->write, memory_order_acquire) - p;
+    return (n > bc->mask) ? bc->mask : n;
+}
+
+/// @brief Exposes the unread bytes of reader id in place. Without gate the
+/// producer may overwrite them meanwhile: trust them only if CbBcastCommit
+/// returns true.
+size_t CbBcastPeekSpans(cb_bcast_t * bc, size_t id, cb_span_t span[2]){
+    CB_ASSERT(bc != NULL && span != NULL && id < bc->n_readers);
+    cb_reader_t *rd = &bc->rd[id];
+    size_t p = atomic_load_explicit(&rd->pos, memory_order_acquire);
+    size_t w = atomic_load_explicit(&bc->write, memory_order_acquire);
+    rd->peek_pos = p;
+    // p may be stale against w, the capped view then fails at commit
+    size_t n = w - p;
+    return CbBcastSpansAt(bc, p, (n > bc->mask) ? bc->mask : n, span);
+}
+
+/// @brief Consumes n bytes seen with CbBcastPeekSpans
+/// @return false if the producer overran the reader in between
+bool CbBcastCommit(cb_bcast_t * bc, size_t id, size_t n){
+    CB_ASSERT(bc != NULL && id < bc->n_readers);
+    cb_reader_t *rd = &bc->rd[id];
+    size_t p = rd->peek_pos;
+    if(!atomic_compare_exchange_strong_explicit(&rd->pos, &p, p + n,
+                                                memory_order_acq_rel, memory_order_acquire)){
+        return false;
+    }
+    rd->next = p + n;
+    return true;
+}
+
+/// @brief Copies up to n bytes for reader id
+/// @param lost bytes skipped by overruns right before the ones returned, may be NULL
+/// @return bytes read
+size_t CbBcastRead(cb_bcast_t * bc, size_t id, uint8_t * out, size_t n, size_t * lost){
+    CB_ASSERT(bc != NULL && out != NULL && id < bc->n_readers);
+    cb_reader_t *rd = &bc->rd[id];
+    size_t prev = rd->next, got = 0;
+    for(;;){
+        cb_span_t span[2];
+        size_t avail = CbBcastPeekSpans(bc, id, span);
+        got = (avail < n) ? avail : n;
+        if(got == 0) break;
+        size_t n0 = (got < span[0].len) ? got : span[0].len;
+        memcpy(out, span[0].ptr, n0);
+        if(got > n0) memcpy(out + n0, span[1].ptr, got - n0);
+        if(CbBcastCommit(bc, id, got)) break;
+        // overrun while copying, the copy may be torn: retry from the new cursor
+    }
+    // the gap between the last commit and this one is exactly what overruns skipped
+    if(lost) *lost = rd->peek_pos - prev;
+    rd->next = rd->peek_pos + got;
+    return got;
+}
+
+/// @brief (Re)joins reader id at the current producer position
+void CbBcastAttach(cb_bcast_t * bc, size_t id){
+    CB_ASSERT(bc != NULL && id < bc->n_readers);
+    size_t w = atomic_load_explicit(&bc->write, memory_order_acquire);
+    bc->rd[id].next = w;
+    atomic_store_explicit(&bc->rd[id].pos, w, memory_order_relaxed);
+    atomic_store_explicit(&bc->rd[id].active, true, memory_order_release);
+}
+
+/// @brief Stops tracking reader id, it no longer holds the producer back
+void CbBcastDetach(cb_bcast_t * bc, size_t id){
+    CB_ASSERT(bc != NULL && id < bc->n_readers);
+    atomic_store_explicit(&bc->rd[id].active, false, memory_order_release);
+}
+
+#endif // CB_HAS_ATOMICS
+
 
 #endif // CBUFFER_IMP
 
@@ -2,6 +2,24 @@
 #ifndef TIMERS_H_
 #define TIMERS_H_
 #include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "string.h"
+
+#if defined(__linux__)
+#define TIMERS_HAS_SVC 1
+#define TIMERS_HAS_DISP 1
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#endif
+
+#if !defined(__STDC_NO_ATOMICS__)
+#define TIMERS_HAS_ATOMICS 1
+#include "stdatomic.h"
+#endif
 typedef struct{
     bool on;
     bool end;
@@ -16,6 +34,213 @@ void MyTimerStop(mytimer_t * tim);
 void MyTimerCycle(mytimer_t * tim);
 void MyTimerReset(mytimer_t * tim);
 
+#ifdef TIMERS_HAS_ATOMICS
+/*
+    Concurrent mytimer_t: one thread ticks ATimerCycle (timer_th), any
+    thread checks, consumes and rearms. Expiries are counted, not flagged:
+    a periodic timer that fires twice before anyone looks reports 2, and
+    ATimerConsume hands each expiry to exactly one caller (atomic exchange),
+    so two threads polling the same timer never both act on one expiry and
+    a fast tick rate never overwrites an unread one. Expiry is exactly len
+    ticks after start/reset. A start/stop racing a tick may be off by that
+    one tick.
+*/
+#define ATIMER_ON       1u
+#define ATIMER_PERIODIC 2u
+
+typedef struct{
+    _Atomic uint32_t state;     // ATIMER_*
+    _Atomic uint32_t count;
+    _Atomic uint32_t len;
+    _Atomic uint32_t fired;     // expiries not consumed yet
+}atimer_t;
+
+void ATimerInit(atimer_t * tim);
+void ATimerStart(atimer_t * tim, uint32_t timeout_ms, bool periodic);
+void ATimerStop(atimer_t * tim);
+void ATimerReset(atimer_t * tim);
+void ATimerCycle(atimer_t * tim);
+uint32_t ATimerConsume(atimer_t * tim);
+bool ATimerExpired(atimer_t * tim);
+uint32_t ATimerRemaining(atimer_t * tim);
+#endif // TIMERS_HAS_ATOMICS
+
+/*
+    Deadline timers: no tick count, the expiry is an absolute now_ns()
+    time and DTimerCheck compares against the clock, so a late or irregular
+    caller never stretches a timeout. Periodic timers stay on their original
+    grid (start + k * period): a late check returns how many periods went by
+    and rearms at the next grid point after now. Lateness of every expiry
+    (check time - deadline) can go into a shared log2 histogram to watch
+    scheduler jitter; it is written by the checking thread only.
+*/
+#define TIMER_LAT_BUCKETS 64
+#define DTIMER_MS(ms) ((uint64_t)(ms) * 1000000ull)
+#define DTIMER_US(us) ((uint64_t)(us) * 1000ull)
+
+typedef struct
+{
+    uint64_t hist[TIMER_LAT_BUCKETS];   // bucket b: lateness in [2^b, 2^(b+1)) ns
+    uint64_t cnt;
+    uint64_t sum;
+    uint64_t max;
+}timer_lat_t;
+
+typedef struct{
+    uint64_t deadline;  // ns, now_ns() base
+    uint64_t period;    // ns, 0 = one shot
+    bool on;
+    uint64_t overruns;  // whole periods that passed unseen
+    timer_lat_t *lat;   // optional
+}dtimer_t;
+
+void DTimerInit(dtimer_t * tim, timer_lat_t * lat);
+void DTimerStart(dtimer_t * tim, uint64_t timeout_ns, uint64_t period_ns);
+void DTimerStartAt(dtimer_t * tim, uint64_t deadline_ns, uint64_t period_ns);
+void DTimerStop(dtimer_t * tim);
+uint32_t DTimerCheck(dtimer_t * tim);
+uint32_t DTimerCheckAt(dtimer_t * tim, uint64_t now_ns);
+uint64_t DTimerRemaining(const dtimer_t * tim);
+uint64_t TimerLatPercentile(const timer_lat_t * lat, double pct);
+void TimerLatReset(timer_lat_t * lat);
+
+
+/*
+    Hierarchical timing wheel: TW_LEVELS levels of TW_SLOTS lists, 1 tick
+    (1 ms) per level-0 slot, each level TW_SLOTS times coarser, so 4 x 256
+    covers 2^32 ms (~49 days). Start and stop are O(1) list operations, a
+    tick fires one level-0 slot and, every TW_SLOTS ticks, spreads one
+    coarser slot down. Timers are caller memory, nothing is allocated.
+    Callbacks run inside TwTick/TwAdvance and may start or stop any timer,
+    including their own.
+*/
+#define TW_LVL_BITS   8u
+#define TW_SLOTS      (1u << TW_LVL_BITS)
+#define TW_LEVELS     4u
+
+typedef struct tw_timer_t tw_timer_t;
+typedef void (*tw_cb_t)(tw_timer_t * tim, void * ctx);
+
+typedef struct tw_timer_t
+{
+    tw_timer_t *next;
+    tw_timer_t **pprev;  // NULL while not queued
+    uint64_t expires;    // wheel tick it fires at
+    uint32_t period;     // 0 = one shot
+    tw_cb_t cb;
+    void *ctx;
+}tw_timer_t;
+
+typedef struct
+{
+    uint64_t now;        // current tick (ms)
+    size_t active;
+    size_t fired;
+    tw_timer_t *slot[TW_LEVELS][TW_SLOTS];
+}tw_wheel_t;
+
+void TwInit(tw_wheel_t * w, uint64_t now_ms);
+void TwStart(tw_wheel_t * w, tw_timer_t * tim, uint32_t timeout_ms, uint32_t period_ms, tw_cb_t cb, void * ctx);
+void TwStartAt(tw_wheel_t * w, tw_timer_t * tim, uint64_t expires, uint32_t period_ms, tw_cb_t cb, void * ctx);
+void TwStop(tw_wheel_t * w, tw_timer_t * tim);
+bool TwPending(const tw_timer_t * tim);
+size_t TwTick(tw_wheel_t * w);
+size_t TwAdvance(tw_wheel_t * w, uint64_t now_ms);
+uint64_t TwNextExpiry(const tw_wheel_t * w);
+
+#ifdef TIMERS_HAS_SVC
+/*
+    Timer service: a wheel driven by an absolute CLOCK_MONOTONIC timerfd
+    armed at the next expiry, so the thread sleeps instead of polling
+    now_ms(). After a late wakeup every due timer still fires (periodic ones
+    once per missed period). The fd can go in the application's own
+    epoll/poll set: call TimerSvcDispatch when it is readable. Callbacks
+    only ever run inside TimerSvcDispatch. Not locked: start/stop timers from
+    the dispatching thread (callbacks included) or under the caller's lock.
+*/
+typedef struct
+{
+    tw_wheel_t *w;
+    int fd;
+    uint64_t armed;    // ms the timerfd is set to, 0 = disarmed
+    bool busy;         // inside TimerSvcDispatch
+    size_t wakeups;
+    size_t fired;
+}timer_svc_t;
+
+bool TimerSvcInit(timer_svc_t * svc, tw_wheel_t * w);
+void TimerSvcClose(timer_svc_t * svc);
+int TimerSvcFd(const timer_svc_t * svc);
+void TimerSvcStart(timer_svc_t * svc, tw_timer_t * tim, uint32_t timeout_ms, uint32_t period_ms, tw_cb_t cb, void * ctx);
+void TimerSvcStop(timer_svc_t * svc, tw_timer_t * tim);
+size_t TimerSvcDispatch(timer_svc_t * svc);
+size_t TimerSvcWait(timer_svc_t * svc, int timeout_ms);
+#endif // TIMERS_HAS_SVC
+
+bool TimersClockCalibrate(uint32_t ms);
+
+#ifdef TIMERS_HAS_DISP
+#ifndef TIMER_MAX
+#define TIMER_MAX 64
+#endif
+/*
+    Callback timers on a process-wide dispatcher thread (a timer service),
+    started by the first TimerAdd. Callbacks run one at a time on that
+    thread, keep them short and hand real work to a cb_t or a worker.
+    Handles carry a generation, so cancelling a fired one-shot or a stale
+    handle is a no-op. Once TimerCancel returns the callback is not running
+    and will not run again; it may also be called from inside the callback.
+*/
+typedef uint64_t timer_h;   // slot generation << 32 | slot + 1, 0 = invalid
+typedef void (*timer_cb_t)(timer_h h, void * ctx);
+
+timer_h TimerAdd(uint32_t period_ms, bool oneshot, timer_cb_t cb, void * ctx);
+bool TimerCancel(timer_h h);
+bool TimerActive(timer_h h);
+void TimerDispatcherStop(void);
+#endif // TIMERS_HAS_DISP
+
+/*
+    Deadline queue: a 4-ary min-heap of absolute now_ms() deadlines, for a
+    few sparse timers in a tickless loop. Nothing runs between expirations;
+    the loop sleeps for TimerNextDeadline() and then calls TimerHeapExpire:
+        for(;;){
+            poll(fds, n, TimerNextDeadline(&heap));
+            ...
+            TimerHeapExpire(&heap);
+        }
+    Start/stop are O(log n), the heap array is caller memory. Callbacks run
+    inside TimerHeapRun and may start or stop any timer, including their own.
+*/
+typedef struct th_timer th_timer_t;
+typedef void (*th_cb_t)(th_timer_t * tim, void * ctx);
+
+struct th_timer
+{
+    uint64_t deadline;  // ms, now_ms() base
+    uint32_t period;    // ms, 0 = one shot
+    size_t idx;         // heap position + 1, 0 = not queued
+    th_cb_t cb;
+    void *ctx;
+};
+
+typedef struct
+{
+    th_timer_t **heap;
+    size_t cap;
+    size_t len;
+}timer_heap_t;
+
+void TimerHeapInit(timer_heap_t * h, th_timer_t ** storage, size_t cap);
+bool TimerHeapStart(timer_heap_t * h, th_timer_t * tim, uint32_t timeout_ms, uint32_t period_ms, th_cb_t cb, void * ctx);
+bool TimerHeapStartAt(timer_heap_t * h, th_timer_t * tim, uint64_t deadline_ms, uint32_t period_ms, th_cb_t cb, void * ctx);
+void TimerHeapStop(timer_heap_t * h, th_timer_t * tim);
+bool TimerHeapPending(const th_timer_t * tim);
+uint64_t TimerHeapNext(const timer_heap_t * h);
+size_t TimerHeapRun(timer_heap_t * h, uint64_t now_ms);
+size_t TimerHeapExpire(timer_heap_t * h);
+int TimerNextDeadline(const timer_heap_t * h);
+
 
 #ifndef UNUSED_VAR
 #define UNUSED_VAR(a) (void)(a)
@@ -53,6 +278,123 @@ void MyTimerReset(mytimer_t * tim);
   }
 #endif
 
+/*
+    Nanosecond clock for instrumentation. now_ns() starts on the OS clock
+    (CLOCK_MONOTONIC_RAW where available); after TimersClockCalibrate() on
+    x86 with an invariant TSC it becomes one RDTSC plus a fixed-point scale,
+    anchored to the OS clock at calibration time so readings stay continuous.
+    now_ms() stays on CLOCK_MONOTONIC, the timerfd service depends on it.
+    now_cycles() deltas convert with cycles_to_ns(); without a TSC they are
+    already nanoseconds. To timestamp c_buffer chunks with it:
+        #define CB_NOW_NS() now_ns()
+    before including c_buffer.h in the TIMERS_IMP translation unit.
+*/
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TIMERS_HAS_TSC 1
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#define TIMERS_TSC_SHIFT 24 // mult = 2^24 * 1e9 / f_tsc fits 32 bits for f_tsc above 1e9 / 2^8 ~ 3.9 MHz
+
+static struct
+{
+    uint64_t tsc0;
+    uint64_t ns0;
+    uint64_t mult;  // ns per cycle << TIMERS_TSC_SHIFT
+    bool tsc;       // published last, read with acquire
+}timers_clk = { .mult = 1ull << TIMERS_TSC_SHIFT };
+
+#if defined(_WIN32)
+  static inline uint64_t os_now_ns(void){
+      static LARGE_INTEGER f = {0};
+      LARGE_INTEGER c;
+      if(!f.QuadPart){ QueryPerformanceFrequency(&f); }
+      QueryPerformanceCounter(&c);
+      uint64_t q = (uint64_t)c.QuadPart, fr = (uint64_t)f.QuadPart;
+      return (q / fr) * 1000000000ull + (q % fr) * 1000000000ull / fr;
+  }
+#else
+  static inline uint64_t os_now_ns(void){
+      struct timespec ts;
+  #ifdef CLOCK_MONOTONIC_RAW
+      clock_gettime(CLOCK_MONOTONIC_RAW, &ts); // not slewed by NTP
+  #else
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+  #endif
+      return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+  }
+#endif
+
+/// @brief Cycle delta from now_cycles() to ns (identity before calibration)
+static inline uint64_t cycles_to_ns(uint64_t cycles){
+    // split so the product never needs more than 64 bits
+    uint64_t mult = timers_clk.mult;
+    return (cycles >> TIMERS_TSC_SHIFT) * mult +
+           (((cycles & ((1ull << TIMERS_TSC_SHIFT) - 1)) * mult) >> TIMERS_TSC_SHIFT);
+}
+
+/// @brief Raw timestamp: TSC cycles once calibrated, OS ns otherwise
+static inline uint64_t now_cycles(void){
+#ifdef TIMERS_HAS_TSC
+    if(__atomic_load_n(&timers_clk.tsc, __ATOMIC_ACQUIRE)) return __rdtsc();
+#endif
+    return os_now_ns();
+}
+
+static inline uint64_t now_ns(void){
+#ifdef TIMERS_HAS_TSC
+    if(__atomic_load_n(&timers_clk.tsc, __ATOMIC_ACQUIRE)){
+        return timers_clk.ns0 + cycles_to_ns(__rdtsc() - timers_clk.tsc0);
+    }
+#endif
+    return os_now_ns();
+}
+
+static inline uint64_t now_us(void){
+    return now_ns() / 1000u;
+}
+
+/// @brief Measures the TSC rate against the OS clock for about ms milliseconds
+/// and switches now_ns()/now_cycles() to it. Call once at startup, before any
+/// now_cycles() deltas are taken. Define TIMERS_TSC_FORCE to skip the
+/// invariant-TSC check (some hypervisors hide the flag).
+/// @return true if the TSC path is in use
+bool TimersClockCalibrate(uint32_t ms){
+#ifdef TIMERS_HAS_TSC
+    unsigned a, b, c, d;
+    bool invariant = __get_cpuid(0x80000007u, &a, &b, &c, &d) && (d & (1u << 8));
+  #ifndef TIMERS_TSC_FORCE
+    if(!invariant) return false;
+  #else
+    UNUSED_VAR(invariant);
+  #endif
+    if(ms == 0) ms = 1;
+    // each sample: OS clock bracketed by two TSC reads, take the midpoint
+    uint64_t c0 = __rdtsc(), t0 = os_now_ns(), c0b = __rdtsc();
+    uint64_t t1, c1, c1b;
+    do{
+        c1 = __rdtsc();
+        t1 = os_now_ns();
+        c1b = __rdtsc();
+    }while(t1 - t0 < (uint64_t)ms * 1000000ull);
+    uint64_t cyc = (c1 + c1b) / 2 - (c0 + c0b) / 2;
+    if(cyc == 0) return false;
+    uint64_t mult = (uint64_t)(((double)(t1 - t0) * (double)(1ull << TIMERS_TSC_SHIFT)) / (double)cyc + 0.5);
+    if(mult == 0 || mult >> 32) return false;
+
+    __atomic_store_n(&timers_clk.tsc, false, __ATOMIC_RELEASE);
+    timers_clk.mult = mult;
+    timers_clk.tsc0 = (c1 + c1b) / 2;
+    timers_clk.ns0 = t1;
+    __atomic_store_n(&timers_clk.tsc, true, __ATOMIC_RELEASE);
+    return true;
+#else
+    UNUSED_VAR(ms);
+    return false;
+#endif
+}
+
 void MyTimerInit(mytimer_t * tim){
     tim->count = 0;
     tim->end = false;
@@ -81,6 +423,637 @@ void MyTimerReset(mytimer_t * tim){
     tim->end = false;
     tim->on = true;
 }
+
+#ifdef TIMERS_HAS_ATOMICS
+void ATimerInit(atimer_t * tim){
+    atomic_init(&tim->state, 0);
+    atomic_init(&tim->count, 0);
+    atomic_init(&tim->len, 0);
+    atomic_init(&tim->fired, 0);
+}
+
+void ATimerStart(atimer_t * tim, uint32_t timeout_ms, bool periodic){
+    atomic_store_explicit(&tim->state, 0, memory_order_relaxed);
+    atomic_store_explicit(&tim->len, timeout_ms ? timeout_ms : 1, memory_order_relaxed);
+    atomic_store_explicit(&tim->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&tim->fired, 0, memory_order_relaxed);
+    atomic_store_explicit(&tim->state, ATIMER_ON | (periodic ? ATIMER_PERIODIC : 0u), memory_order_release);
+}
+
+/// @brief Stops counting and drops expiries nobody consumed
+void ATimerStop(atimer_t * tim){
+    atomic_fetch_and_explicit(&tim->state, ~ATIMER_ON, memory_order_relaxed);
+    atomic_store_explicit(&tim->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&tim->fired, 0, memory_order_release);
+}
+
+/// @brief Counts the timeout again from now. Unlike MyTimerReset it keeps
+/// unconsumed expiries: consume first, then reset.
+void ATimerReset(atimer_t * tim){
+    atomic_store_explicit(&tim->count, 0, memory_order_relaxed);
+    atomic_fetch_or_explicit(&tim->state, ATIMER_ON, memory_order_release);
+}
+
+void ATimerCycle(atimer_t * tim){
+    uint32_t st = atomic_load_explicit(&tim->state, memory_order_acquire);
+    if(!(st & ATIMER_ON)) return;
+    uint32_t len = atomic_load_explicit(&tim->len, memory_order_relaxed);
+    uint32_t c = atomic_fetch_add_explicit(&tim->count, 1, memory_order_relaxed) + 1;
+    if(c < len) return;
+    if(st & ATIMER_PERIODIC){
+        // a concurrent reset wins: it already restarted the period
+        if(!atomic_compare_exchange_strong_explicit(&tim->count, &c, 0,
+                                                    memory_order_relaxed, memory_order_relaxed)) return;
+    }else{
+        // one shot: only the tick that clears ON raises the expiry
+        if(!(atomic_fetch_and_explicit(&tim->state, ~ATIMER_ON, memory_order_relaxed) & ATIMER_ON)) return;
+    }
+    atomic_fetch_add_explicit(&tim->fired, 1, memory_order_release);
+}
+
+/// @brief Takes every pending expiry, each one goes to exactly one caller
+/// @return expiries taken, 0 if none
+uint32_t ATimerConsume(atimer_t * tim){
+    if(atomic_load_explicit(&tim->fired, memory_order_relaxed) == 0) return 0; // keep the line shared
+    return atomic_exchange_explicit(&tim->fired, 0, memory_order_acq_rel);
+}
+
+/// @brief Peeks at the expiry without consuming it
+bool ATimerExpired(atimer_t * tim){
+    return atomic_load_explicit(&tim->fired, memory_order_acquire) != 0;
+}
+
+/// @brief Ticks left until the next expiry, so the ticking thread can sleep that long
+/// @return ticks, UINT32_MAX if the timer is stopped
+uint32_t ATimerRemaining(atimer_t * tim){
+    if(!(atomic_load_explicit(&tim->state, memory_order_acquire) & ATIMER_ON)) return UINT32_MAX;
+    uint32_t len = atomic_load_explicit(&tim->len, memory_order_relaxed);
+    uint32_t c = atomic_load_explicit(&tim->count, memory_order_relaxed);
+    return (c < len) ? len - c : 1;
+}
+#endif // TIMERS_HAS_ATOMICS
+
+
+// Links tim in the slot its expiry falls in, relative to the current tick.
+// Anything due before now + soon goes to that slot (cascades pass 0: the
+// current level-0 slot runs right after them).
+static void TwLink(tw_wheel_t * w, tw_timer_t * tim, uint64_t soon){
+    uint64_t exp = tim->expires;
+    if(exp < w->now + soon) exp = w->now + soon;
+    uint64_t delta = exp - w->now;
+    size_t lvl = 0;
+    while(lvl < TW_LEVELS - 1 && delta >= (1ull << (TW_LVL_BITS * (lvl + 1)))) lvl++;
+    if(delta >= (1ull << (TW_LVL_BITS * TW_LEVELS))){
+        exp = w->now + (1ull << (TW_LVL_BITS * TW_LEVELS)) - 1; // out of range: park, relinked on cascade
+    }
+    tw_timer_t **head = &w->slot[lvl][(exp >> (TW_LVL_BITS * lvl)) & (TW_SLOTS - 1)];
+    tim->next = *head;
+    if(*head) (*head)->pprev = &tim->next;
+    tim->pprev = head;
+    *head = tim;
+}
+
+static void TwUnlink(tw_timer_t * tim){
+    if(tim->next) tim->next->pprev = tim->pprev;
+    *tim->pprev = tim->next;
+    tim->next = NULL;
+    tim->pprev = NULL;
+}
+
+// Moves the whole list at *head to a local list, keeping the back links valid
+static tw_timer_t * TwDetach(tw_timer_t ** head, tw_timer_t ** local){
+    *local = *head;
+    *head = NULL;
+    if(*local) (*local)->pprev = local;
+    return *local;
+}
+
+void TwInit(tw_wheel_t * w, uint64_t now_ms){
+    memset(w, 0, sizeof *w);
+    w->now = now_ms;
+}
+
+/// @brief (Re)arms tim to fire timeout_ms ticks from now, then every period_ms
+/// (0 = one shot). Periodic expiries are computed from the previous expiry, not
+/// from when the callback ran, so they do not drift.
+void TwStart(tw_wheel_t * w, tw_timer_t * tim, uint32_t timeout_ms, uint32_t period_ms, tw_cb_t cb, void * ctx){
+    TwStartAt(w, tim, w->now + (timeout_ms ? timeout_ms : 1), period_ms, cb, ctx);
+}
+
+/// @brief TwStart at an absolute tick; one not after the current tick fires on the next
+void TwStartAt(tw_wheel_t * w, tw_timer_t * tim, uint64_t expires, uint32_t period_ms, tw_cb_t cb, void * ctx){
+    if(tim->pprev) TwStop(w, tim);
+    tim->expires = (expires > w->now) ? expires : w->now + 1;
+    tim->period = period_ms;
+    tim->cb = cb;
+    tim->ctx = ctx;
+    TwLink(w, tim, 1);
+    w->active++;
+}
+
+void TwStop(tw_wheel_t * w, tw_timer_t * tim){
+    if(!tim->pprev) return;
+    TwUnlink(tim);
+    w->active--;
+}
+
+bool TwPending(const tw_timer_t * tim){
+    return tim->pprev != NULL;
+}
+
+/// @brief Advances the wheel one tick (1 ms) and runs what expires on it
+/// @return timers fired
+size_t TwTick(tw_wheel_t * w){
+    w->now++;
+    // cascade: when a level wraps, spread the next slot of the level above
+    for(size_t lvl = 1; lvl < TW_LEVELS; ++lvl){
+        if((w->now & ((1ull << (TW_LVL_BITS * lvl)) - 1)) != 0) break;
+        tw_timer_t *local, *tim;
+        TwDetach(&w->slot[lvl][(w->now >> (TW_LVL_BITS * lvl)) & (TW_SLOTS - 1)], &local);
+        while((tim = local) != NULL){
+            TwUnlink(tim);
+            TwLink(w, tim, 0);
+        }
+    }
+
+    size_t fired = 0;
+    tw_timer_t *local, *tim;
+    TwDetach(&w->slot[0][w->now & (TW_SLOTS - 1)], &local);
+    while((tim = local) != NULL){
+        TwUnlink(tim);
+        if(tim->period){
+            tim->expires += tim->period;
+            TwLink(w, tim, 1); // late: catches up one period per tick
+        }else{
+            w->active--;
+        }
+        fired++;
+        if(tim->cb) tim->cb(tim, tim->ctx);
+    }
+    w->fired += fired;
+    return fired;
+}
+
+/// @brief Earliest tick at which TwTick has something to do (fire or cascade)
+/// @return tick, UINT64_MAX if no timer is queued
+uint64_t TwNextExpiry(const tw_wheel_t * w){
+    if(w->active == 0) return UINT64_MAX;
+    uint64_t best = UINT64_MAX;
+    for(size_t lvl = 0; lvl < TW_LEVELS; ++lvl){
+        uint64_t unit = 1ull << (TW_LVL_BITS * lvl);
+        uint64_t base = w->now >> (TW_LVL_BITS * lvl);
+        // level-0 slots are ticks, coarser ones are the ticks they cascade at
+        for(uint64_t k = 1; k <= TW_SLOTS; ++k){
+            uint64_t at = (base + k) * unit;
+            if(at >= best) break;
+            if(w->slot[lvl][(base + k) & (TW_SLOTS - 1)]){
+                best = at;
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+/// @brief Ticks until the wheel reaches now_ms, catching up on missed ticks.
+/// Stretches with nothing queued are jumped over instead of ticked.
+/// @return timers fired
+size_t TwAdvance(tw_wheel_t * w, uint64_t now_ms){
+    size_t fired = 0;
+    while(w->now < now_ms){
+        if(now_ms - w->now > TW_SLOTS){
+            uint64_t next = TwNextExpiry(w);
+            if(next > now_ms){
+                w->now = now_ms;
+                break;
+            }
+            w->now = next - 1;
+        }
+        fired += TwTick(w);
+    }
+    return fired;
+}
+
+static inline void TimerLatAdd(timer_lat_t * lat, uint64_t ns){
+    size_t b = 0;
+    while(b < TIMER_LAT_BUCKETS - 1 && (ns >> (b + 1)) != 0) b++;
+    lat->hist[b]++;
+    lat->cnt++;
+    lat->sum += ns;
+    if(ns > lat->max) lat->max = ns;
+}
+
+/// @brief Upper edge of the bucket holding the pct-th percentile lateness, in ns
+uint64_t TimerLatPercentile(const timer_lat_t * lat, double pct){
+    if(lat->cnt == 0) return 0;
+    uint64_t rank = (uint64_t)((double)lat->cnt * pct / 100.0);
+    if(rank >= lat->cnt) rank = lat->cnt - 1;
+    uint64_t acc = 0;
+    for(size_t b = 0; b < TIMER_LAT_BUCKETS; ++b){
+        acc += lat->hist[b];
+        if(acc > rank) return (b + 1 < TIMER_LAT_BUCKETS) ? (2ull << b) - 1 : UINT64_MAX;
+    }
+    return lat->max;
+}
+
+void TimerLatReset(timer_lat_t * lat){
+    memset(lat, 0, sizeof *lat);
+}
+
+void DTimerInit(dtimer_t * tim, timer_lat_t * lat){
+    memset(tim, 0, sizeof *tim);
+    tim->lat = lat;
+}
+
+/// @brief Expires at an absolute now_ns() time, then every period_ns (0 = one shot)
+void DTimerStartAt(dtimer_t * tim, uint64_t deadline_ns, uint64_t period_ns){
+    tim->deadline = deadline_ns;
+    tim->period = period_ns;
+    tim->on = true;
+}
+
+/// @brief Expires timeout_ns from now, use DTIMER_MS()/DTIMER_US() for other units
+void DTimerStart(dtimer_t * tim, uint64_t timeout_ns, uint64_t period_ns){
+    DTimerStartAt(tim, now_ns() + timeout_ns, period_ns);
+}
+
+void DTimerStop(dtimer_t * tim){
+    tim->on = false;
+}
+
+/// @brief Expiry check against a caller supplied now_ns() reading
+/// @return periods elapsed since the last expiry (0 = not due, 1 = on time)
+uint32_t DTimerCheckAt(dtimer_t * tim, uint64_t now_ns){
+    if(!tim->on || now_ns < tim->deadline) return 0;
+    uint64_t late = now_ns - tim->deadline;
+    if(tim->lat) TimerLatAdd(tim->lat, late);
+    if(!tim->period){
+        tim->on = false;
+        return 1;
+    }
+    // next grid point strictly after now: lateness does not shift the phase
+    uint64_t n = late / tim->period + 1;
+    tim->deadline += n * tim->period;
+    tim->overruns += n - 1;
+    return (n > UINT32_MAX) ? UINT32_MAX : (uint32_t)n;
+}
+
+uint32_t DTimerCheck(dtimer_t * tim){
+    return DTimerCheckAt(tim, now_ns());
+}
+
+/// @brief ns until the deadline (0 if due), UINT64_MAX if stopped
+uint64_t DTimerRemaining(const dtimer_t * tim){
+    if(!tim->on) return UINT64_MAX;
+    uint64_t now = now_ns();
+    return (now >= tim->deadline) ? 0 : tim->deadline - now;
+}
+
+#define TH_ARITY 4
+
+static inline void TimerHeapPut(timer_heap_t * h, size_t i, th_timer_t * tim){
+    h->heap[i] = tim;
+    tim->idx = i + 1;
+}
+
+static void TimerHeapUp(timer_heap_t * h, size_t i){
+    th_timer_t *tim = h->heap[i];
+    while(i > 0){
+        size_t parent = (i - 1) / TH_ARITY;
+        if(h->heap[parent]->deadline <= tim->deadline) break;
+        TimerHeapPut(h, i, h->heap[parent]);
+        i = parent;
+    }
+    TimerHeapPut(h, i, tim);
+}
+
+static void TimerHeapDown(timer_heap_t * h, size_t i){
+    th_timer_t *tim = h->heap[i];
+    for(;;){
+        size_t first = i * TH_ARITY + 1;
+        if(first >= h->len) break;
+        size_t last = (first + TH_ARITY < h->len) ? first + TH_ARITY : h->len;
+        size_t min = first;
+        for(size_t c = first + 1; c < last; ++c){
+            if(h->heap[c]->deadline < h->heap[min]->deadline) min = c;
+        }
+        if(h->heap[min]->deadline >= tim->deadline) break;
+        TimerHeapPut(h, i, h->heap[min]);
+        i = min;
+    }
+    TimerHeapPut(h, i, tim);
+}
+
+void TimerHeapInit(timer_heap_t * h, th_timer_t ** storage, size_t cap){
+    h->heap = storage;
+    h->cap = cap;
+    h->len = 0;
+}
+
+/// @brief (Re)arms tim at an absolute deadline, then every period_ms (0 = one shot)
+/// @return false if the heap is full
+bool TimerHeapStartAt(timer_heap_t * h, th_timer_t * tim, uint64_t deadline_ms, uint32_t period_ms, th_cb_t cb, void * ctx){
+    tim->period = period_ms;
+    tim->cb = cb;
+    tim->ctx = ctx;
+    if(tim->idx){
+        // already queued: move it in place
+        uint64_t old = tim->deadline;
+        tim->deadline = deadline_ms;
+        if(deadline_ms < old) TimerHeapUp(h, tim->idx - 1);
+        else TimerHeapDown(h, tim->idx - 1);
+        return true;
+    }
+    if(h->len == h->cap) return false;
+    tim->deadline = deadline_ms;
+    h->heap[h->len] = tim;
+    TimerHeapUp(h, h->len++);
+    return true;
+}
+
+/// @brief TimerHeapStartAt timeout_ms from now_ms()
+bool TimerHeapStart(timer_heap_t * h, th_timer_t * tim, uint32_t timeout_ms, uint32_t period_ms, th_cb_t cb, void * ctx){
+    return TimerHeapStartAt(h, tim, now_ms() + timeout_ms, period_ms, cb, ctx);
+}
+
+void TimerHeapStop(timer_heap_t * h, th_timer_t * tim){
+    if(!tim->idx) return;
+    size_t i = tim->idx - 1;
+    tim->idx = 0;
+    th_timer_t *last = h->heap[--h->len];
+    if(i == h->len) return;
+    // the last leaf takes the hole, then goes whichever way it has to
+    TimerHeapPut(h, i, last);
+    if(i > 0 && h->heap[(i - 1) / TH_ARITY]->deadline > last->deadline) TimerHeapUp(h, i);
+    else TimerHeapDown(h, i);
+}
+
+bool TimerHeapPending(const th_timer_t * tim){
+    return tim->idx != 0;
+}
+
+/// @brief Earliest deadline in ms, UINT64_MAX if nothing is queued
+uint64_t TimerHeapNext(const timer_heap_t * h){
+    return h->len ? h->heap[0]->deadline : UINT64_MAX;
+}
+
+/// @brief Fires everything due at now_ms. Periodic timers rearm from their
+/// previous deadline, once per missed period.
+/// @return timers fired
+size_t TimerHeapRun(timer_heap_t * h, uint64_t now_ms){
+    size_t fired = 0;
+    while(h->len && h->heap[0]->deadline <= now_ms){
+        th_timer_t *tim = h->heap[0];
+        if(tim->period){
+            tim->deadline += tim->period;
+            TimerHeapDown(h, 0);
+        }else{
+            TimerHeapStop(h, tim);
+        }
+        fired++;
+        if(tim->cb) tim->cb(tim, tim->ctx);
+    }
+    return fired;
+}
+
+size_t TimerHeapExpire(timer_heap_t * h){
+    return TimerHeapRun(h, now_ms());
+}
+
+/// @brief ms until the earliest deadline, as a poll/epoll_wait timeout
+/// @return -1 if nothing is queued (block), 0 if something is already due
+int TimerNextDeadline(const timer_heap_t * h){
+    if(!h->len) return -1;
+    uint64_t next = h->heap[0]->deadline, now = now_ms();
+    if(next <= now) return 0;
+    return (next - now > INT32_MAX) ? INT32_MAX : (int)(next - now);
+}
+
+#ifdef TIMERS_HAS_SVC
+// Programs the timerfd for the wheel's next expiry (absolute ms)
+static void TimerSvcArm(timer_svc_t * svc){
+    uint64_t next = TwNextExpiry(svc->w);
+    if(next == svc->armed) return;
+    struct itimerspec its = {0};
+    if(next != UINT64_MAX){
+        its.it_value.tv_sec = (time_t)(next / 1000u);
+        its.it_value.tv_nsec = (long)(next % 1000u) * 1000000L;
+    }
+    timerfd_settime(svc->fd, TFD_TIMER_ABSTIME, &its, NULL);
+    svc->armed = (next == UINT64_MAX) ? 0 : next;
+}
+
+/// @brief Creates the timerfd and syncs the wheel with now_ms()
+/// @return false if the timerfd could not be created
+bool TimerSvcInit(timer_svc_t * svc, tw_wheel_t * w){
+    memset(svc, 0, sizeof *svc);
+    svc->w = w;
+    svc->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(svc->fd < 0) return false;
+    TwAdvance(w, now_ms());
+    TimerSvcArm(svc);
+    return true;
+}
+
+void TimerSvcClose(timer_svc_t * svc){
+    if(svc->fd >= 0) close(svc->fd);
+    svc->fd = -1;
+}
+
+/// @brief fd readable when a timer is due, for the caller's epoll/poll loop
+int TimerSvcFd(const timer_svc_t * svc){
+    return svc->fd;
+}
+
+/// @brief TwStart relative to the current time, reprograms the fd if needed.
+/// Never fires anything: only TimerSvcDispatch runs callbacks.
+void TimerSvcStart(timer_svc_t * svc, tw_timer_t * tim, uint32_t timeout_ms, uint32_t period_ms, tw_cb_t cb, void * ctx){
+    if(svc->busy){
+        // from a callback the wheel is current
+        TwStart(svc->w, tim, timeout_ms, period_ms, cb, ctx);
+        return;
+    }
+    // the wheel lags while asleep: place the timer at an absolute time
+    // instead of advancing it here, which would run callbacks on this thread
+    uint64_t now = now_ms();
+    if(svc->w->active == 0 && svc->w->now < now) svc->w->now = now; // nothing to fire
+    TwStartAt(svc->w, tim, now + (timeout_ms ? timeout_ms : 1), period_ms, cb, ctx);
+    TimerSvcArm(svc);
+}
+
+void TimerSvcStop(timer_svc_t * svc, tw_timer_t * tim){
+    TwStop(svc->w, tim);
+    if(!svc->busy) TimerSvcArm(svc);
+}
+
+/// @brief Runs everything due up to now and rearms, call when the fd is readable
+/// @return timers fired
+size_t TimerSvcDispatch(timer_svc_t * svc){
+    uint64_t exp;
+    ssize_t rc = read(svc->fd, &exp, sizeof exp); // clears readability, EAGAIN is fine
+    (void)rc;
+    svc->armed = 0;
+    svc->wakeups++;
+    svc->busy = true;
+    size_t fired = TwAdvance(svc->w, now_ms());
+    svc->busy = false;
+    svc->fired += fired;
+    TimerSvcArm(svc);
+    return fired;
+}
+
+/// @brief Sleeps until the next expiry or timeout_ms (< 0 = forever) and dispatches
+/// @return timers fired
+size_t TimerSvcWait(timer_svc_t * svc, int timeout_ms){
+    struct pollfd pfd = { .fd = svc->fd, .events = POLLIN };
+    int rc;
+    do{ rc = poll(&pfd, 1, timeout_ms); }while(rc < 0 && errno == EINTR);
+    return (rc > 0) ? TimerSvcDispatch(svc) : 0;
+}
+#endif // TIMERS_HAS_SVC
+
+#ifdef TIMERS_HAS_DISP
+typedef struct
+{
+    tw_timer_t tw;
+    timer_cb_t cb;
+    void *ctx;
+    uint32_t gen;       // a stale handle only aliases after 2^32 reuses of its slot
+    bool used;
+    bool oneshot;
+}timer_slot_t;
+
+static struct
+{
+    pthread_mutex_t mtx;
+    pthread_t th;
+    bool running;
+    bool stop;
+    tw_wheel_t w;
+    timer_svc_t svc;
+    timer_slot_t slot[TIMER_MAX];
+}timer_disp = { .mtx = PTHREAD_MUTEX_INITIALIZER };
+
+// set on the dispatcher thread: callbacks already hold the lock
+static _Thread_local bool timer_in_disp;
+
+static timer_h TimerHandle(const timer_slot_t * sl){
+    return ((uint64_t)sl->gen << 32) | (uint64_t)(sl - timer_disp.slot + 1);
+}
+
+static timer_slot_t * TimerSlot(timer_h h){
+    size_t idx = (size_t)(h & 0xFFFFFFFFu);
+    if(idx == 0 || idx > TIMER_MAX) return NULL;
+    timer_slot_t *sl = &timer_disp.slot[idx - 1];
+    return (sl->used && sl->gen == (uint32_t)(h >> 32)) ? sl : NULL;
+}
+
+static void TimerFree(timer_slot_t * sl){
+    sl->used = false;
+    sl->gen++; // outstanding handles go stale
+}
+
+static void TimerFire(tw_timer_t * tim, void * ctx){
+    UNUSED_VAR(tim);
+    timer_slot_t *sl = ctx;
+    timer_h h = TimerHandle(sl);
+    timer_cb_t cb = sl->cb;
+    void *cb_ctx = sl->ctx;
+    if(sl->oneshot) TimerFree(sl); // the callback may reuse the slot
+    cb(h, cb_ctx);
+}
+
+static void * TimerDispMain(void * arg){
+    UNUSED_VAR(arg);
+    timer_in_disp = true;
+    struct pollfd pfd = { .fd = timer_disp.svc.fd, .events = POLLIN };
+    pthread_mutex_lock(&timer_disp.mtx);
+    while(!timer_disp.stop){
+        pthread_mutex_unlock(&timer_disp.mtx);
+        // timerfd_settime from TimerAdd/TimerCancel takes effect on this poll
+        int rc = poll(&pfd, 1, -1);
+        pthread_mutex_lock(&timer_disp.mtx);
+        if(rc > 0 && !timer_disp.stop) TimerSvcDispatch(&timer_disp.svc);
+    }
+    pthread_mutex_unlock(&timer_disp.mtx);
+    return NULL;
+}
+
+/// @brief Calls cb(handle, ctx) every period_ms, or once after period_ms
+/// @return handle, 0 if every TIMER_MAX slot is taken or the thread failed
+timer_h TimerAdd(uint32_t period_ms, bool oneshot, timer_cb_t cb, void * ctx){
+    if(!cb || (!oneshot && period_ms == 0)) return 0;
+    timer_h h = 0;
+    if(!timer_in_disp) pthread_mutex_lock(&timer_disp.mtx);
+    if(!timer_disp.running){
+        TwInit(&timer_disp.w, 0);
+        if(!TimerSvcInit(&timer_disp.svc, &timer_disp.w)) goto out;
+        timer_disp.stop = false;
+        if(pthread_create(&timer_disp.th, NULL, TimerDispMain, NULL) != 0){
+            TimerSvcClose(&timer_disp.svc);
+            goto out;
+        }
+        timer_disp.running = true;
+    }
+    for(size_t i = 0; i < TIMER_MAX; ++i){
+        timer_slot_t *sl = &timer_disp.slot[i];
+        if(sl->used) continue;
+        sl->used = true;
+        sl->cb = cb;
+        sl->ctx = ctx;
+        sl->oneshot = oneshot;
+        TimerSvcStart(&timer_disp.svc, &sl->tw, period_ms, oneshot ? 0 : period_ms, TimerFire, sl);
+        h = TimerHandle(sl);
+        break;
+    }
+out:
+    if(!timer_in_disp) pthread_mutex_unlock(&timer_disp.mtx);
+    return h;
+}
+
+/// @brief Stops a timer; waits for its callback if it is running on the dispatcher
+/// @return false for a stale handle (already cancelled or one-shot fired)
+bool TimerCancel(timer_h h){
+    if(!timer_in_disp) pthread_mutex_lock(&timer_disp.mtx);
+    timer_slot_t *sl = TimerSlot(h);
+    if(sl){
+        TimerSvcStop(&timer_disp.svc, &sl->tw);
+        TimerFree(sl);
+    }
+    if(!timer_in_disp) pthread_mutex_unlock(&timer_disp.mtx);
+    return sl != NULL;
+}
+
+bool TimerActive(timer_h h){
+    if(!timer_in_disp) pthread_mutex_lock(&timer_disp.mtx);
+    bool act = TimerSlot(h) != NULL;
+    if(!timer_in_disp) pthread_mutex_unlock(&timer_disp.mtx);
+    return act;
+}
+
+/// @brief Cancels every timer and joins the dispatcher, not from a callback
+void TimerDispatcherStop(void){
+    pthread_mutex_lock(&timer_disp.mtx);
+    if(!timer_disp.running){
+        pthread_mutex_unlock(&timer_disp.mtx);
+        return;
+    }
+    timer_disp.stop = true;
+    struct itimerspec its = { .it_value = { 0, 1 } }; // wake the poll now
+    timerfd_settime(timer_disp.svc.fd, 0, &its, NULL);
+    pthread_mutex_unlock(&timer_disp.mtx);
+    pthread_join(timer_disp.th, NULL);
+
+    for(size_t i = 0; i < TIMER_MAX; ++i){
+        timer_slot_t *sl = &timer_disp.slot[i];
+        if(sl->used) TimerFree(sl);
+        memset(&sl->tw, 0, sizeof sl->tw);
+    }
+    TimerSvcClose(&timer_disp.svc);
+    timer_disp.running = false;
+}
+#endif // TIMERS_HAS_DISP
+
 #endif // TIMERS_IMP
 
 
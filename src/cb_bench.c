@@ -0,0 +1,317 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define CB_SPSC
+#define CBUFFER_IMP
+#include "c_buffer.h"
+
+#define BENCH_CB_SZ     (1u << 20)
+#define BENCH_BYTES     (1ull << 30)
+#define BENCH_CHUNK     (16u << 10)
+
+static uint8_t bench_mem[BENCH_CB_SZ];
+static cb_t bench_cb;
+
+static double bench_now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// ---------------- SPSC throughput ----------------
+
+static void * spsc_producer(void * arg){
+    (void)arg;
+    static uint8_t chunk[BENCH_CHUNK];
+    uint64_t sent = 0;
+    while(sent < BENCH_BYTES){
+        chunk[0] = (uint8_t)sent;
+        if(CbWrite(&bench_cb, chunk, BENCH_CHUNK) == 0){ sched_yield(); continue; }
+        sent += BENCH_CHUNK;
+    }
+    return NULL;
+}
+
+static void bench_spsc(void){
+    CbInit(&bench_cb, bench_mem, BENCH_CB_SZ, "bench_spsc");
+    static uint8_t out[BENCH_CHUNK];
+    uint64_t recv = 0;
+
+    double t0 = bench_now_s();
+    pthread_t th;
+    pthread_create(&th, NULL, spsc_producer, NULL);
+    while(recv < BENCH_BYTES){
+        size_t got = CbRead(&bench_cb, out, sizeof out);
+        if(got == 0){ sched_yield(); continue; }
+        recv += got;
+    }
+    pthread_join(th, NULL);
+    double s = bench_now_s() - t0;
+
+    printf("[spsc] %llu MB in %.3f s -> %.2f GB/s (drops=%zu)\n",
+           (unsigned long long)(recv >> 20), s, (double)recv / s / 1e9, CbStats(&bench_cb).full_cnt);
+}
+
+// ---------------- Delimiter scan ----------------
+// Byte loops as they were before CbFind, kept as the reference.
+
+static size_t legacy_read_until(cb_t * cb, uint8_t * out, size_t max, uint8_t byte){
+    size_t v = CB_LOAD_RLX(cb->read);
+    size_t avail = CbDataCount(cb);
+    if (max > avail) max = avail;
+    size_t i = 0;
+    for (; i < max; ++i, ++v){
+        out[i] = cb->data[v & cb->mask];
+        if (out[i] == byte){ i++; break; }
+    }
+    CbReadInc(cb, i);
+    return i;
+}
+
+static void legacy_syn_start(cb_t * cb, uint8_t start_B){
+    while(!CbIsEmpty(cb) && (cb->data[CB_LOAD_RLX(cb->read) & cb->mask] != start_B)){
+        CbReadInc(cb, 1);
+    }
+}
+
+#define SCAN_CB_SZ      (2u << 20)
+#define SCAN_TOTAL      (256ull << 20)
+#define SCAN_DELIM      0x7E
+
+static uint8_t scan_mem[SCAN_CB_SZ];
+static uint8_t scan_out[SCAN_CB_SZ];
+
+// Leaves `occupancy` bytes in the ring, wrapped, with the delimiter as last byte.
+static size_t scan_fill(cb_t * cb, size_t occupancy){
+    CbInit(cb, scan_mem, SCAN_CB_SZ, "bench_scan");
+    size_t r0 = SCAN_CB_SZ - occupancy / 2;
+    CB_STORE_REL(cb->write, r0);
+    CB_STORE_REL(cb->read, r0);
+    cb_span_t span[2];
+    CbWriteReserve(cb, span);
+    for(size_t i = 0; i < occupancy; ++i){
+        uint8_t b = (i == occupancy - 1) ? SCAN_DELIM : (uint8_t)(i % SCAN_DELIM);
+        if(i < span[0].len) span[0].ptr[i] = b;
+        else span[1].ptr[i - span[0].len] = b;
+    }
+    CbWriteCommit(cb, occupancy);
+    return r0;
+}
+
+static void bench_scan(void){
+    static const size_t occ[] = { 1u << 10, 64u << 10, 1u << 20 };
+    cb_t cb;
+#if !defined(CB_NO_SIMD) && defined(__AVX2__)
+    const char *path = "avx2";
+#elif !defined(CB_NO_SIMD) && defined(__SSE2__)
+    const char *path = "sse2";
+#else
+    const char *path = "scalar";
+#endif
+
+    for(size_t k = 0; k < ARRAY_LEN(occ); ++k){
+        size_t n = occ[k];
+        size_t iters = (size_t)(SCAN_TOTAL / n);
+        size_t r0 = scan_fill(&cb, n);
+        double t[4];
+
+        double t0 = bench_now_s();
+        for(size_t i = 0; i < iters; ++i){ CB_STORE_REL(cb.read, r0); legacy_read_until(&cb, scan_out, n, SCAN_DELIM); }
+        t[0] = bench_now_s() - t0;
+
+        t0 = bench_now_s();
+        for(size_t i = 0; i < iters; ++i){ CB_STORE_REL(cb.read, r0); CbReadUntil(&cb, scan_out, n, SCAN_DELIM); }
+        t[1] = bench_now_s() - t0;
+
+        t0 = bench_now_s();
+        for(size_t i = 0; i < iters; ++i){ CB_STORE_REL(cb.read, r0); legacy_syn_start(&cb, SCAN_DELIM); }
+        t[2] = bench_now_s() - t0;
+
+        t0 = bench_now_s();
+        for(size_t i = 0; i < iters; ++i){ CB_STORE_REL(cb.read, r0); CbDmaSynStart(&cb, SCAN_DELIM); }
+        t[3] = bench_now_s() - t0;
+
+        double gb = (double)iters * (double)n / 1e9;
+        printf("[scan %4zu KB] ReadUntil loop %6.2f GB/s  %s %6.2f GB/s | SynStart loop %6.2f GB/s  %s %6.2f GB/s\n",
+               n >> 10, gb / t[0], path, gb / t[1], gb / t[2], path, gb / t[3]);
+    }
+}
+
+// ---------------- MPMC contention ----------------
+
+#define MPMC_Q_SZ       4096
+#define MPMC_ITEMS      (1u << 22)
+#define MPMC_BATCH      16
+#define MPMC_MAX_PROD   16
+
+static size_t mpmc_mem[CB_MPMC_MEM_SZ(MPMC_Q_SZ, sizeof(uint64_t)) / sizeof(size_t)];
+static cb_mpmc_t mpmc_q;
+
+static void * mpmc_producer(void * arg){
+    size_t n = (size_t)(uintptr_t)arg;
+    uint64_t batch[MPMC_BATCH] = {0};
+    while(n > 0){
+        size_t want = (n < MPMC_BATCH) ? n : MPMC_BATCH;
+        size_t sent = CbMpmcPushN(&mpmc_q, batch, want);
+        if(sent == 0){ sched_yield(); continue; }
+        n -= sent;
+    }
+    return NULL;
+}
+
+static void bench_mpmc(void){
+    static const size_t producers[] = { 1, 2, 4, 8, 16 };
+    uint64_t batch[MPMC_BATCH];
+
+    for(size_t k = 0; k < ARRAY_LEN(producers); ++k){
+        size_t np = producers[k];
+        CbMpmcInit(&mpmc_q, mpmc_mem, MPMC_Q_SZ, sizeof(uint64_t), "bench_mpmc");
+
+        pthread_t th[MPMC_MAX_PROD];
+        double t0 = bench_now_s();
+        for(size_t i = 0; i < np; ++i){
+            pthread_create(&th[i], NULL, mpmc_producer, (void *)(uintptr_t)(MPMC_ITEMS / np));
+        }
+        size_t got = 0, total = (MPMC_ITEMS / np) * np;
+        while(got < total){
+            size_t n = CbMpmcPopN(&mpmc_q, batch, MPMC_BATCH);
+            if(n == 0){ sched_yield(); continue; }
+            got += n;
+        }
+        for(size_t i = 0; i < np; ++i) pthread_join(th[i], NULL);
+        double s = bench_now_s() - t0;
+
+        printf("[mpmc %2zu prod -> 1 cons] %.2f Mitems/s\n", np, (double)got / s / 1e6);
+    }
+}
+
+// ---------------- DMA frame decoder ----------------
+// dma_th from main.c: a circular DMA fills the memory every 1 ms and the
+// consumer only learns about it through NDTR (CbDmaWrInc).
+
+#define FRAME_CB_SZ     (64u << 10)
+#define FRAME_RUN_S     0.5
+#define FRAME_BAD_EVERY 100 // one corrupted frame out of N
+
+static uint8_t frame_mem[FRAME_CB_SZ];
+static cb_t frame_cb;
+static volatile bool frame_run;
+static size_t frame_sent, frame_bytes_sent;
+static double frame_rate; // bytes per second
+
+static size_t frame_encode(uint8_t * out, size_t seq){
+    uint16_t len = (uint16_t)(32 + seq % 33);
+    out[0] = 0xAA; out[1] = 0x55;
+    out[2] = (uint8_t)(len >> 8); out[3] = (uint8_t)len;
+    for(uint16_t i = 0; i < len; ++i) out[4 + i] = (uint8_t)(seq + i);
+    uint16_t crc = CbCrc16(0xFFFF, out + 2, 2u + len);
+    out[4 + len] = (uint8_t)(crc >> 8);
+    out[5 + len] = (uint8_t)crc;
+    if(seq % FRAME_BAD_EVERY == FRAME_BAD_EVERY - 1) out[6] ^= 0x5A;
+    return 6u + len;
+}
+
+static void * frame_dma_th(void * arg){
+    (void)arg;
+    uint8_t fr[128];
+    size_t fr_len = 0, fr_pos = 0, seq = 0;
+    uint32_t ndtr = FRAME_CB_SZ;
+    double budget = 0, t_last = bench_now_s();
+
+    while(frame_run){
+        struct timespec ms = { 0, 1000000L };
+        nanosleep(&ms, NULL);
+        double t = bench_now_s();
+        budget += (t - t_last) * frame_rate;
+        t_last = t;
+
+        size_t chunk = (size_t)budget;
+        budget -= (double)chunk;
+        for(size_t i = 0; i < chunk; ++i){
+            if(fr_pos == fr_len){
+                fr_len = frame_encode(fr, seq++);
+                fr_pos = 0;
+                frame_sent++;
+            }
+            frame_mem[(FRAME_CB_SZ - ndtr) & (FRAME_CB_SZ - 1)] = fr[fr_pos++];
+            ndtr = (ndtr == 1) ? FRAME_CB_SZ : ndtr - 1;
+        }
+        frame_bytes_sent += chunk;
+        CbDmaWrInc(&frame_cb, (int32_t)ndtr);
+    }
+    return NULL;
+}
+
+static double bench_cpu_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void frame_decoder_init(cb_frame_dec_t * dec){
+    CbFrameInit(dec, &frame_cb, .sync = 0xAA55, .sync_len = 2, .len_off = 2, .len_sz = 2,
+                .crc = CB_CRC16_CCITT, .max_payload = 256);
+}
+
+static void bench_frames(void){
+    static const double rates[] = { 11520.0, 92160.0, 1152000.0, 9216000.0 }; // 115200/921600 baud, x100
+    static const char *names[] = { "115200 baud", "921600 baud", "115200 x100", "921600 x100" };
+    cb_frame_dec_t dec;
+    cb_frame_t fr;
+
+    for(size_t k = 0; k < ARRAY_LEN(rates); ++k){
+        CbInit(&frame_cb, frame_mem, FRAME_CB_SZ, "bench_frames");
+        frame_decoder_init(&dec);
+        frame_rate = rates[k];
+        frame_sent = frame_bytes_sent = 0;
+        frame_run = true;
+
+        pthread_t th;
+        pthread_create(&th, NULL, frame_dma_th, NULL);
+        double t0 = bench_now_s(), c0 = bench_cpu_s();
+        while(bench_now_s() - t0 < FRAME_RUN_S){
+            while(CbFrameNext(&dec, &fr)){}
+            struct timespec ms = { 0, 1000000L };
+            nanosleep(&ms, NULL);
+        }
+        frame_run = false;
+        pthread_join(th, NULL);
+        while(CbFrameNext(&dec, &fr)){}
+        double cpu = bench_cpu_s() - c0, wall = bench_now_s() - t0;
+
+        printf("[frames %s] %7.1f KB/s sent=%zu ok=%zu crc_err=%zu resync=%zu overrun=%zu  decoder cpu %.2f%%\n",
+               names[k], (double)frame_bytes_sent / wall / 1e3, frame_sent, dec.frames,
+               dec.crc_errors, dec.resyncs, CbStats(&frame_cb).full_cnt, 100.0 * cpu / wall);
+    }
+
+    // raw decoder speed on a full ring
+    CbInit(&frame_cb, frame_mem, FRAME_CB_SZ, "bench_frames");
+    frame_decoder_init(&dec);
+    uint8_t fr_buf[128];
+    size_t bytes = 0, seq = 0;
+    double busy = 0;
+    while(bytes < (256u << 20)){
+        size_t n;
+        while((n = frame_encode(fr_buf, seq)) <= CbEmptyCount(&frame_cb)){
+            CbWrite(&frame_cb, fr_buf, n);
+            bytes += n;
+            seq++;
+        }
+        double t0 = bench_now_s();
+        while(CbFrameNext(&dec, &fr)){}
+        busy += bench_now_s() - t0;
+    }
+    printf("[frames offline] %.1f MB/s decoded, %zu frames, crc_err=%zu\n",
+           (double)bytes / busy / 1e6, dec.frames, dec.crc_errors);
+}
+
+int main(void){
+    bench_spsc();
+    bench_scan();
+    bench_mpmc();
+    bench_frames();
+    return 0;
+}
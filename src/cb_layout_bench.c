@@ -0,0 +1,203 @@
+/*
+    SPSC layout benchmark: small messages between two pinned threads, with
+    hardware counters read in-process (perf_event_open, user space only).
+    Built twice:
+        cb_layout_bench         producer/consumer lines + cached indices
+        cb_layout_bench_packed  -DCB_PACKED_LAYOUT, indices and counters on one line
+    cb_layout_bench also runs the packed build next to it (--result) and
+    prints the difference, so it is useful without a PMU (VMs, containers):
+    throughput and task-clock per message still show the false sharing.
+*/
+#define _GNU_SOURCE
+#include "stdio.h"
+#include "stdlib.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <stddef.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <string.h>
+
+#define CB_SPSC
+#define CBUFFER_IMP
+#include "c_buffer.h"
+
+#define LAYOUT_CB_SZ    (64u << 10)
+#define LAYOUT_MSG      64u
+#define LAYOUT_MSGS     (16u << 20)
+
+#ifdef CB_PACKED_LAYOUT
+#define LAYOUT_NAME "packed"
+#else
+#define LAYOUT_NAME "lines+cache"
+#endif
+
+static uint8_t layout_mem[LAYOUT_CB_SZ];
+static cb_t layout_cb;
+
+typedef struct
+{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    int fd;
+}perf_ctr_t;
+
+#define PERF_CACHE(c, op, res) ((c) | ((op) << 8) | ((res) << 16))
+
+static perf_ctr_t perf_ctrs[] = {
+    {"cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1},
+    {"instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1},
+    {"cache-refs",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, -1},
+    {"cache-misses",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1},
+    {"L1d-ld-misses", PERF_TYPE_HW_CACHE, PERF_CACHE(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                                     PERF_COUNT_HW_CACHE_RESULT_MISS), -1},
+    {"LLC-ld-misses", PERF_TYPE_HW_CACHE, PERF_CACHE(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                                                     PERF_COUNT_HW_CACHE_RESULT_MISS), -1},
+    // still there when the PMU is not exposed (VMs, containers)
+    {"task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, -1},
+    {"ctx-switches",  PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, -1},
+};
+
+// Counters follow this thread and every thread it creates afterwards
+static void perf_open(void){
+    for(size_t i = 0; i < ARRAY_LEN(perf_ctrs); ++i){
+        struct perf_event_attr pe;
+        memset(&pe, 0, sizeof pe);
+        pe.size = sizeof pe;
+        pe.type = perf_ctrs[i].type;
+        pe.config = perf_ctrs[i].config;
+        pe.disabled = 1;
+        pe.inherit = 1;
+        pe.exclude_kernel = 1;
+        pe.exclude_hv = 1;
+        perf_ctrs[i].fd = (int)syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0);
+    }
+}
+
+static void perf_ctl(unsigned long req){
+    for(size_t i = 0; i < ARRAY_LEN(perf_ctrs); ++i){
+        if(perf_ctrs[i].fd >= 0) ioctl(perf_ctrs[i].fd, req, 0);
+    }
+}
+
+// Prints every counter (unless quiet), returns task-clock ns per message or -1
+static double perf_report(uint64_t msgs, bool quiet){
+    double task_ns = -1.0;
+    for(size_t i = 0; i < ARRAY_LEN(perf_ctrs); ++i){
+        uint64_t v;
+        if(perf_ctrs[i].fd < 0 || read(perf_ctrs[i].fd, &v, sizeof v) != (ssize_t)sizeof v){
+            if(!quiet) printf("  %-14s n/a\n", perf_ctrs[i].name);
+            continue;
+        }
+        if(perf_ctrs[i].type == PERF_TYPE_SOFTWARE && perf_ctrs[i].config == PERF_COUNT_SW_TASK_CLOCK){
+            task_ns = (double)v / (double)msgs;
+        }
+        if(!quiet) printf("  %-14s %14llu  %8.3f /msg\n", perf_ctrs[i].name,
+                          (unsigned long long)v, (double)v / (double)msgs);
+        close(perf_ctrs[i].fd);
+    }
+    return task_ns;
+}
+
+#define LAYOUT_LINE(field) (offsetof(cb_t, field) / CB_CACHELINE_SZ)
+
+#ifndef CB_PACKED_LAYOUT
+// Runs the packed build with --result and prints both side by side
+static void layout_compare(const char * self, double mmsgs, double task_ns){
+    char cmd[512];
+    snprintf(cmd, sizeof cmd, "%s_packed --result", self);
+    FILE *f = popen(cmd, "r");
+    double p_mmsgs = 0.0, p_task = -1.0;
+    int got = f ? fscanf(f, "result %lf %lf", &p_mmsgs, &p_task) : 0;
+    if(f) pclose(f);
+    if(got != 2 || p_mmsgs <= 0.0){
+        printf("[compare] %s_packed not found or failed, run it by hand\n", self);
+        return;
+    }
+    printf("[compare] lines+cache vs packed baseline\n");
+    printf("  throughput     %8.1f vs %8.1f Mmsg/s  (x%.2f)\n", mmsgs, p_mmsgs, mmsgs / p_mmsgs);
+    if(task_ns >= 0.0 && p_task >= 0.0){
+        printf("  task-clock     %8.1f vs %8.1f ns/msg  (%+.1f ns/msg)\n", task_ns, p_task, task_ns - p_task);
+    }
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n < 2) printf("  (1 CPU online: both sides time-share one core, no line ever bounces)\n");
+}
+#endif
+
+static double layout_now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void layout_pin(int cpu){
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n < 2) return; // nothing to separate
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % n, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+}
+
+static void * layout_producer(void * arg){
+    (void)arg;
+    layout_pin(1);
+    uint8_t msg[LAYOUT_MSG] = {0};
+    for(uint32_t i = 0; i < LAYOUT_MSGS; ){
+        msg[0] = (uint8_t)i;
+        if(CbWrite(&layout_cb, msg, sizeof msg) == 0){ sched_yield(); continue; }
+        ++i;
+    }
+    return NULL;
+}
+
+int main(int argc, char ** argv){
+    bool result_only = (argc > 1 && strcmp(argv[1], "--result") == 0);
+    CbInit(&layout_cb, layout_mem, LAYOUT_CB_SZ, "layout");
+    bool shared = LAYOUT_LINE(write) == LAYOUT_LINE(read) && LAYOUT_LINE(write) == LAYOUT_LINE(full_cnt);
+#ifdef CB_PACKED_LAYOUT
+    if(!shared){
+        fprintf(stderr, "packed layout does not share a line, nothing to measure\n");
+        return 2;
+    }
+#endif
+    if(!result_only){
+        printf("[layout %s] sizeof(cb_t)=%zu write@%zu read@%zu full_cnt@%zu -> %s\n", LAYOUT_NAME,
+               sizeof(cb_t), offsetof(cb_t, write), offsetof(cb_t, read), offsetof(cb_t, full_cnt),
+               shared ? "one shared line" : "separate lines");
+    }
+
+    layout_pin(0);
+    perf_open();
+    perf_ctl(PERF_EVENT_IOC_RESET);
+    perf_ctl(PERF_EVENT_IOC_ENABLE);
+
+    double t0 = layout_now_s();
+    pthread_t th;
+    pthread_create(&th, NULL, layout_producer, NULL);
+    uint8_t out[LAYOUT_MSG];
+    size_t bad = 0;
+    for(uint32_t i = 0; i < LAYOUT_MSGS; ){
+        if(CbRead(&layout_cb, out, sizeof out) == 0){ sched_yield(); continue; }
+        bad += (out[0] != (uint8_t)i);
+        ++i;
+    }
+    pthread_join(th, NULL);
+    double s = layout_now_s() - t0;
+    perf_ctl(PERF_EVENT_IOC_DISABLE);
+
+    double mmsgs = (double)LAYOUT_MSGS / s / 1e6;
+    double task_ns = perf_report(LAYOUT_MSGS, result_only);
+    if(result_only){
+        printf("result %.3f %.3f\n", mmsgs, task_ns);
+        return bad != 0;
+    }
+    printf("  %u msgs of %u B in %.3f s -> %.1f Mmsg/s (bad=%zu)\n", LAYOUT_MSGS, LAYOUT_MSG,
+           s, mmsgs, bad);
+#ifndef CB_PACKED_LAYOUT
+    layout_compare(argv[0], mmsgs, task_ns);
+#endif
+    return bad != 0;
+}
@@ -11,6 +11,7 @@
 #include "stdlib.h"
 #include "time.h"
 
+#define CB_SPSC
 #define CBUFFER_IMP
 #include "c_buffer.h"
 #define TIMERS_IMP
@@ -18,6 +19,7 @@
 
 #define BUFFER_SZ 4096
 #define TIME_BETWEEN_WRITING_MS 2000
+#define CONSUMER_MODE_A 0   // 1: slow consumer (MODO A), 0: MODO B
 
 typedef enum{
     GENERAL_READ = 0U,
@@ -27,17 +29,20 @@ typedef enum{
 
 static uint8_t in_buffer[BUFFER_SZ];
 static cb_t cb;
-static mytimer_t tim[MAX_TIMERS_IND];
+#ifdef CB_HAS_WAIT
+static cb_notify_t cb_ntf;
+#endif
+static atimer_t tim[MAX_TIMERS_IND];   // ticked by timer_th, consumed by main
 
 // this is like a dma interrupt callback in stm32
 RETURN_TYPE dma_th(void *arg){
     (void)arg;
     // simulamos NDTR: empieza “lleno” (no escribió nada todavía)
     uint32_t ndtr = BUFFER_SZ;
-    uint32_t last = now_ms();
+    uint64_t last = now_ms();
 
     for(;;){
-        uint32_t now = now_ms();
+        uint64_t now = now_ms();
         if ((now - last) >= 10) {                // cada 10 ms “llega” un bloque
             // tamaño aleatorio de “lote” entrante
             uint16_t chunk = (uint16_t)(rand() % 50);
@@ -81,17 +86,66 @@ RETURN_TYPE dma_th(void *arg){
 #endif
 }
 
+#define TIMER_TH_IDLE_MS 100   // longest sleep, bounds the delay for atimers started meanwhile
+
+// Runs one atimer cycle per ms elapsed since the last call and returns the ms
+// until the next expiry, so timer_th sleeps instead of waking every ms
+static uint32_t atimers_update(void){
+    static uint64_t last;
+    uint64_t now = now_ms();
+    if(last == 0) last = now;
+    for(; last < now; ++last){
+        for(size_t i = 0; i < MAX_TIMERS_IND; i++) ATimerCycle(&tim[i]);
+    }
+    uint32_t next = TIMER_TH_IDLE_MS;
+    for(size_t i = 0; i < MAX_TIMERS_IND; i++){
+        uint32_t left = ATimerRemaining(&tim[i]);
+        if(left < next) next = left;
+    }
+    return next;
+}
+
+#ifdef TIMERS_HAS_SVC
+// one shot, rearmed at the next atimer expiry
+static void timer_tick_cb(tw_timer_t * t, void * ctx){
+    TimerSvcStart((timer_svc_t *)ctx, t, atimers_update(), 0, timer_tick_cb, ctx);
+}
+#endif
+
+#if CONSUMER_MODE_A && defined(TIMERS_HAS_DISP)
+// MODO A on a callback timer
+static void slow_read_cb(timer_h h, void * ctx){
+    UNUSED_VAR(h); UNUSED_VAR(ctx);
+    uint8_t out = 0;
+    size_t got = CbRead(&cb, &out, 1);
+    cb_stats_t st = CbStats(&cb);
+    printf("[A] read=%zu byte=%u  used=%zu  free=%zu  full_cnt=%zu\n",
+           got, out, st.used, CbEmptyCount(&cb), st.full_cnt);
+}
+#endif
+
 // this is like a timer interrupt callback in stm32
 RETURN_TYPE timer_th(void * arg){
     UNUSED_VAR(arg);
-    uint32_t last = 0;
-    while(1){
-        uint32_t now = now_ms();
-        if((now - last) >= 1){ // evry 1 ms
-            for(size_t i = 0; i < MAX_TIMERS_IND; i++) MyTimerCycle(&tim[i]);
-            last = now;
-        }
-        
+#ifdef TIMERS_HAS_SVC
+    // sleep on the timerfd until the next expiry
+    static tw_wheel_t wheel;
+    static tw_timer_t tick;
+    timer_svc_t svc;
+    TwInit(&wheel, 0);
+    if(TimerSvcInit(&svc, &wheel)){
+        TimerSvcStart(&svc, &tick, atimers_update(), 0, timer_tick_cb, &svc);
+        for(;;) TimerSvcWait(&svc, -1);
+    }
+#endif
+    for(;;){
+        uint32_t ms = atimers_update();
+#if defined(__unix__) || defined(__APPLE__) 
+        struct timespec ts = { .tv_sec = ms / 1000u, .tv_nsec = (long)(ms % 1000u) * 1000000L };
+        nanosleep(&ts, NULL);   // waking early only means another update
+#else
+        thrd_sleep(&(struct timespec){ .tv_sec = ms / 1000u, .tv_nsec = (long)(ms % 1000u) * 1000000L }, NULL);
+#endif
     }
 #if defined(__unix__) || defined(__APPLE__) 
     return NULL;
@@ -111,10 +165,15 @@ int main(){
 
 
     CbInit(&cb, in_buffer, BUFFER_SZ, "test_cb");
-    for (size_t i=0; i<MAX_TIMERS_IND; ++i) MyTimerInit(&tim[i]);
+#ifdef CB_HAS_WAIT
+    CbNotifyInit(&cb, &cb_ntf, 0);
+#endif
+    for (size_t i=0; i<MAX_TIMERS_IND; ++i) ATimerInit(&tim[i]);
 
-    // Timers de muestra (usa el GENERAL_READ o quítalo si prefieres el modo B de lectura)
-    MyTimerStart(&tim[GENERAL_READ], 5000);
+#if CONSUMER_MODE_A && !defined(TIMERS_HAS_DISP)
+    // MODO A without the dispatcher: timer_th ticks GENERAL_READ, main polls it
+    ATimerStart(&tim[GENERAL_READ], 5000, true);
+#endif
 #if defined(__unix__) || defined(__APPLE__) 
     pthread_create(&th_dma, NULL, dma_th, NULL);
     pthread_create(&th_tim, NULL, timer_th, NULL);
@@ -124,32 +183,46 @@ int main(){
 #endif
 
     // --- MODO A: consumidor muy lento (cada 5 s) ---
-#if 0
+#if CONSUMER_MODE_A
+#ifdef TIMERS_HAS_DISP
+    // the dispatcher thread is the only consumer, nothing polls .end
+    TimerAdd(5000, false, slow_read_cb, NULL);
+    for(;;) pause();
+#else
     uint8_t out = 0;
     for(;;){
-        if (tim[GENERAL_READ].end) {
+        if (ATimerConsume(&tim[GENERAL_READ])) {
             size_t got = CbRead(&cb, &out, 1);
-            printf("[A] read=%zu byte=%u  used=%zu  free=%zu  full_cnt=%zu  dma_cnt=%zu\n",
-                   got, out, (size_t)((cb.write - cb.read) & cb.mask),
-                   (size_t)(cb.mask - ((cb.write - cb.read) & cb.mask)),
-                   cb.full_cnt, cb.dma_cnt);
-            MyTimerReset(&tim[GENERAL_READ]);
+            cb_stats_t st = CbStats(&cb);
+            printf("[A] read=%zu byte=%u  used=%zu  free=%zu  full_cnt=%zu\n",
+                   got, out, st.used, CbEmptyCount(&cb), st.full_cnt);
         }
     }
+#endif // TIMERS_HAS_DISP
 #else
-    // --- MODO B: consumidor “normal” (cada 50 ms lee 512B) ---
+    // --- MODO B: consumidor “normal” (lee 512B en cuanto llegan, como mucho cada 50 ms) ---
     uint8_t tmp[512];
+#ifdef CB_HAS_WAIT
+    for(;;){
+        CbWaitReadable(&cb, sizeof(tmp), 50);
+        size_t got = CbRead(&cb, tmp, sizeof(tmp));
+        cb_stats_t st = CbStats(&cb);
+        printf("[B] read=%zu  used=%zu  free=%zu  full_cnt=%zu\n",
+                got, st.used, CbEmptyCount(&cb), st.full_cnt);
+    }
+#else
+    // no futex/eventfd: poll every 50 ms
     uint64_t last = now_ms();
     for(;;){
         uint64_t now = now_ms();
         if ((now - last) >= 50) {
             size_t got = CbRead(&cb, tmp, sizeof(tmp));
+            cb_stats_t st = CbStats(&cb);
             printf("[B] read=%zu  used=%zu  free=%zu  full_cnt=%zu\n",
-                    got, (size_t)((cb.write - cb.read) & cb.mask),
-                   (size_t)(cb.mask - ((cb.write - cb.read) & cb.mask)),
-                   cb.full_cnt);
+                    got, st.used, CbEmptyCount(&cb), st.full_cnt);
             last = now;
         }
     }
 #endif
+#endif
 }
@@ -0,0 +1,156 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include <time.h>
+
+#define TIMERS_IMP
+#include "timers.h"
+
+#define BENCH_TIMERS    100000u
+#define BENCH_CHURN     1000000u
+#define BENCH_TICKS     600000u     // 10 minutes of 1 ms ticks
+#define BENCH_SCAN      1000u       // MyTimerCycle reference ticks
+#define BENCH_MAX_MS    (2u * 3600u * 1000u)
+#define BENCH_CLOCK     10000000u
+
+static tw_wheel_t bench_w;
+static tw_timer_t bench_tw[BENCH_TIMERS];
+static mytimer_t bench_my[BENCH_TIMERS];
+static uint32_t bench_to[BENCH_TIMERS];
+static th_timer_t bench_th[BENCH_TIMERS];
+static th_timer_t *bench_th_store[BENCH_TIMERS];
+static timer_heap_t bench_h;
+static uint64_t bench_fired;
+
+static double bench_now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// xorshift, the libc rand() range is too short on some targets
+static uint32_t bench_rand(void){
+    static uint32_t x = 2463534242u;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return x;
+}
+
+// Per-connection style: most timeouts short, some up to hours
+static uint32_t bench_timeout(void){
+    uint32_t r = bench_rand();
+    switch(r & 3u){
+    case 0:  return 1u + (r >> 2) % 1000u;
+    case 1:  return 1u + (r >> 2) % 60000u;
+    default: return 1u + (r >> 2) % BENCH_MAX_MS;
+    }
+}
+
+static void bench_cb(tw_timer_t * tim, void * ctx){
+    (void)ctx;
+    bench_fired++;
+    // keep the population at 100k: a one shot that fires is started again
+    if(!tim->period) TwStart(&bench_w, tim, bench_timeout(), 0, bench_cb, NULL);
+}
+
+// per call cost of one clock source, sum keeps the calls alive
+#define BENCH_CLOCK_RUN(name, expr) do{                                     \
+        uint64_t sum = 0;                                                   \
+        double c0 = bench_now_s();                                          \
+        for(uint32_t k = 0; k < BENCH_CLOCK; ++k) sum += (expr);            \
+        printf("[clock] %-22s %6.1f ns/call (%llu)\n", name,               \
+               (bench_now_s() - c0) * 1e9 / BENCH_CLOCK,                    \
+               (unsigned long long)(sum & 1u));                             \
+    }while(0)
+
+static void bench_clocks(void){
+    BENCH_CLOCK_RUN("now_ms", now_ms());
+    BENCH_CLOCK_RUN("now_ns (os clock)", now_ns());
+    bool tsc = TimersClockCalibrate(50);
+    printf("[clock] tsc %s, %.4f ns/cycle\n", tsc ? "calibrated" : "unavailable",
+           (double)timers_clk.mult / (double)(1ull << TIMERS_TSC_SHIFT));
+    if(!tsc) return;
+    BENCH_CLOCK_RUN("now_ns (tsc)", now_ns());
+    BENCH_CLOCK_RUN("now_cycles (tsc)", now_cycles());
+}
+
+static void bench_th_cb(th_timer_t * tim, void * ctx){
+    uint64_t now = *(uint64_t *)ctx;
+    bench_fired++;
+    if(!tim->period) TimerHeapStartAt(&bench_h, tim, now + bench_timeout(), 0, bench_th_cb, ctx);
+}
+
+// same workload on the deadline heap, run at the same 1 ms cadence
+static void bench_heap(void){
+    static uint64_t now;
+    TimerHeapInit(&bench_h, bench_th_store, BENCH_TIMERS);
+    bench_fired = 0;
+    double t0 = bench_now_s();
+    for(size_t i = 0; i < BENCH_TIMERS; ++i){
+        uint32_t period = (i % 10u == 0) ? 1000u : 0u;
+        TimerHeapStartAt(&bench_h, &bench_th[i], bench_to[i], period, bench_th_cb, &now);
+    }
+    double t_start = bench_now_s() - t0;
+
+    t0 = bench_now_s();
+    for(size_t i = 0; i < BENCH_CHURN; ++i){
+        th_timer_t *tim = &bench_th[bench_rand() % BENCH_TIMERS];
+        TimerHeapStartAt(&bench_h, tim, bench_timeout(), tim->period, bench_th_cb, &now);
+    }
+    double t_churn = bench_now_s() - t0;
+
+    t0 = bench_now_s();
+    for(now = 1; now <= BENCH_TICKS; ++now) TimerHeapRun(&bench_h, now);
+    double t_tick = bench_now_s() - t0;
+
+    printf("[heap ] %u timers  start %.1f ns/op  restart %.1f ns/op\n", BENCH_TIMERS,
+           t_start * 1e9 / BENCH_TIMERS, t_churn * 1e9 / BENCH_CHURN);
+    printf("[heap ] %u ticks with %zu active: %.1f ns/tick, %llu fired (%.1f ns/fire incl. rearm)\n",
+           BENCH_TICKS, bench_h.len, t_tick * 1e9 / BENCH_TICKS,
+           (unsigned long long)bench_fired, bench_fired ? t_tick * 1e9 / (double)bench_fired : 0.0);
+}
+
+int main(void){
+    bench_clocks();
+
+    for(size_t i = 0; i < BENCH_TIMERS; ++i) bench_to[i] = bench_timeout();
+
+    TwInit(&bench_w, 0);
+    double t0 = bench_now_s();
+    for(size_t i = 0; i < BENCH_TIMERS; ++i){
+        uint32_t period = (i % 10u == 0) ? 1000u : 0u; // 10% heartbeats
+        TwStart(&bench_w, &bench_tw[i], bench_to[i], period, bench_cb, NULL);
+    }
+    double t_start = bench_now_s() - t0;
+
+    t0 = bench_now_s();
+    for(size_t i = 0; i < BENCH_CHURN; ++i){
+        tw_timer_t *tim = &bench_tw[bench_rand() % BENCH_TIMERS];
+        TwStart(&bench_w, tim, bench_timeout(), tim->period, bench_cb, NULL); // stop + start
+    }
+    double t_churn = bench_now_s() - t0;
+
+    t0 = bench_now_s();
+    TwAdvance(&bench_w, BENCH_TICKS);
+    double t_tick = bench_now_s() - t0;
+
+    printf("[wheel] %u timers  start %.1f ns/op  restart %.1f ns/op\n", BENCH_TIMERS,
+           t_start * 1e9 / BENCH_TIMERS, t_churn * 1e9 / BENCH_CHURN);
+    printf("[wheel] %u ticks with %zu active: %.1f ns/tick, %llu fired (%.1f ns/fire incl. rearm)\n",
+           BENCH_TICKS, bench_w.active, t_tick * 1e9 / BENCH_TICKS,
+           (unsigned long long)bench_fired, bench_fired ? t_tick * 1e9 / (double)bench_fired : 0.0);
+
+    bench_heap();
+
+    // reference: the O(N) scan timer_th does with mytimer_t
+    for(size_t i = 0; i < BENCH_TIMERS; ++i){
+        MyTimerInit(&bench_my[i]);
+        MyTimerStart(&bench_my[i], bench_to[i]);
+    }
+    t0 = bench_now_s();
+    for(size_t k = 0; k < BENCH_SCAN; ++k){
+        for(size_t i = 0; i < BENCH_TIMERS; ++i) MyTimerCycle(&bench_my[i]);
+    }
+    double t_scan = bench_now_s() - t0;
+    printf("[scan ] %u ticks over %u mytimer_t: %.1f ns/tick\n", BENCH_SCAN, BENCH_TIMERS,
+           t_scan * 1e9 / BENCH_SCAN);
+    return 0;
+}
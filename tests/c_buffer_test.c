@@ -0,0 +1,1184 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+
+// arrival stamps come from a clock the tests drive
+static uint64_t test_clock_ns;
+#define CB_NOW_NS() (test_clock_ns)
+
+#define CBUFFER_IMP
+#include "c_buffer.h"
+
+#define TEST_CB_SZ 64
+
+static uint8_t test_mem[TEST_CB_SZ];
+
+static void test_init(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "init");
+    assert_true(CbIsEmpty(&cb));
+    assert_false(CbIsFull(&cb));
+    assert_int_equal(CbDataCount(&cb), 0);
+    assert_int_equal(CbEmptyCount(&cb), TEST_CB_SZ - 1);
+}
+
+static void test_write_read(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "wr");
+    uint8_t in[20], out[20] = {0};
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)i;
+
+    assert_int_equal(CbWrite(&cb, in, sizeof in), sizeof in);
+    assert_int_equal(CbDataCount(&cb), sizeof in);
+    assert_int_equal(CbRead(&cb, out, sizeof out), sizeof out);
+    assert_memory_equal(in, out, sizeof in);
+    assert_true(CbIsEmpty(&cb));
+    assert_int_equal(CbRead(&cb, out, 1), 0);
+}
+
+static void test_wrap(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "wrap");
+    uint8_t in[40], out[40];
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(i + 100);
+
+    for(int round = 0; round < 10; ++round){
+        assert_int_equal(CbWrite(&cb, in, sizeof in), sizeof in);
+        assert_true(CbContiguousDataCount(&cb) <= sizeof in);
+        memset(out, 0, sizeof out);
+        assert_int_equal(CbRead(&cb, out, sizeof out), sizeof out);
+        assert_memory_equal(in, out, sizeof in);
+    }
+}
+
+static void test_full(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "full");
+    uint8_t b = 0;
+    for(size_t i = 0; i < TEST_CB_SZ - 1; ++i){
+        b = (uint8_t)i;
+        assert_int_equal(CbWrite(&cb, &b, 1), 1);
+    }
+    assert_true(CbIsFull(&cb));
+    assert_int_equal(cb.full_cnt, 0);
+
+    b = 0xAA;
+#ifdef CB_SPSC
+    // producer cannot overwrite, the newest byte is dropped
+    assert_int_equal(CbWrite(&cb, &b, 1), 0);
+    assert_int_equal(cb.full_cnt, 1);
+    assert_int_equal(CbRead(&cb, &b, 1), 1);
+    assert_int_equal(b, 0);
+#else
+    // oldest byte is overwritten
+    assert_int_equal(CbWrite(&cb, &b, 1), 1);
+    assert_int_equal(cb.full_cnt, 1);
+    assert_int_equal(CbRead(&cb, &b, 1), 1);
+    assert_int_equal(b, 1);
+#endif
+}
+
+static void test_policy_stats(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "stats");
+    uint8_t in[40] = {0}, out[40];
+
+    CbSetPolicy(&cb, CB_POLICY_DROP_NEWEST);
+    assert_int_equal(CbWrite(&cb, in, sizeof in), sizeof in);
+    assert_int_equal(CbWrite(&cb, in, sizeof in), 0);       // 40 > 23 free
+    assert_int_equal(CbDataCount(&cb), sizeof in);
+    assert_int_equal(CbRead(&cb, out, sizeof out), sizeof out);
+    assert_int_equal(CbRead(&cb, out, sizeof out), 0);      // stall
+    assert_int_equal(CbWrite(&cb, in, sizeof in), sizeof in); // wraps
+
+    cb_stats_t st = CbStats(&cb);
+    assert_int_equal(st.used, sizeof in);
+    assert_int_equal(st.full_cnt, 1);
+    assert_int_equal(st.bytes_dropped, sizeof in);
+    assert_int_equal(st.high_watermark, sizeof in);
+    assert_int_equal(st.wraps, 1);
+    assert_int_equal(st.read_stalls, 1);
+
+    CbSetPolicy(&cb, CB_POLICY_OVERWRITE);
+#ifdef CB_SPSC
+    assert_int_equal(CbWrite(&cb, in, sizeof in), 0);
+    assert_int_equal(CbStats(&cb).bytes_dropped, 2 * sizeof in);
+#else
+    assert_int_equal(CbWrite(&cb, in, sizeof in), sizeof in);
+    st = CbStats(&cb);
+    assert_int_equal(st.bytes_dropped, sizeof in + (sizeof in - (TEST_CB_SZ - 1 - sizeof in)));
+    assert_int_equal(st.high_watermark, TEST_CB_SZ - 1);
+#endif
+
+    // BLOCK without a notifier degrades to drop instead of spinning
+    CbSetPolicy(&cb, CB_POLICY_BLOCK);
+    size_t dropped = CbStats(&cb).bytes_dropped;
+    assert_int_equal(CbWrite(&cb, in, sizeof in), 0);
+    assert_int_equal(CbStats(&cb).bytes_dropped, dropped + sizeof in);
+}
+
+static void test_read_until(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "until");
+    const char *msg = "abc\ndef\n";
+    uint8_t out[16] = {0};
+    CbWrite(&cb, (const uint8_t*)msg, strlen(msg));
+
+    assert_int_equal(CbReadUntil(&cb, out, sizeof out, '\n'), 4);
+    assert_memory_equal(out, "abc\n", 4);
+    assert_int_equal(CbReadUntil(&cb, out, 2, '\n'), 2);
+    assert_memory_equal(out, "de", 2);
+    assert_int_equal(CbReadUntil(&cb, out, sizeof out, '\n'), 2);
+    assert_memory_equal(out, "f\n", 2);
+    assert_true(CbIsEmpty(&cb));
+}
+
+static void test_find(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "find");
+    uint8_t skip[50] = {0}, in[60], out[64];
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(i + 1);
+    CbWrite(&cb, skip, sizeof skip);
+    CbRead(&cb, skip, sizeof skip);
+    CbWrite(&cb, in, sizeof in);
+
+    // every position, before and after the wrap, through the vector and scalar paths
+    for(size_t i = 0; i < sizeof in; ++i){
+        assert_int_equal(CbFind(&cb, in[i]), i);
+    }
+    assert_int_equal(CbFind(&cb, 0xFF), sizeof in);
+
+    assert_int_equal(CbReadUntil(&cb, out, sizeof out, 45), 45);
+    assert_memory_equal(out, in, 45);
+    assert_int_equal(CbReadUntil(&cb, out, sizeof out, 0xFF), sizeof in - 45);
+    assert_memory_equal(out, in + 45, sizeof in - 45);
+}
+
+static void test_dma(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "dma");
+    memset(test_mem, 0, sizeof test_mem);
+
+    // hardware wrote 10 bytes, start byte at position 4
+    for(size_t i = 0; i < 10; ++i) test_mem[i] = (uint8_t)(i + 1);
+    test_mem[4] = 0x7E;
+    CbDmaWrInc(&cb, TEST_CB_SZ - 10);
+    assert_int_equal(CbDataCount(&cb), 10);
+
+    CbDmaSynStart(&cb, 0x7E);
+    assert_int_equal(CbDataCount(&cb), 6);
+    uint8_t b = 0;
+    CbRead(&cb, &b, 1);
+    assert_int_equal(b, 0x7E);
+
+    // no start byte left: everything is skipped
+    CbDmaSynStart(&cb, 0x7E);
+    assert_true(CbIsEmpty(&cb));
+}
+
+static void test_peek_spans(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "peek");
+    uint8_t in[40], skip[30];
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(i + 1);
+
+    // move the indices close to the end so the next write wraps
+    CbWrite(&cb, in, sizeof skip);
+    CbRead(&cb, skip, sizeof skip);
+    CbWrite(&cb, in, sizeof in);
+
+    cb_span_t span[2];
+    assert_int_equal(CbPeekSpans(&cb, span), sizeof in);
+    assert_int_equal(span[0].len, TEST_CB_SZ - sizeof skip);
+    assert_int_equal(span[0].len, CbContiguousDataCount(&cb));
+    assert_int_equal(span[0].len + span[1].len, sizeof in);
+    assert_ptr_equal(span[0].ptr, &test_mem[sizeof skip]);
+    assert_ptr_equal(span[1].ptr, test_mem);
+    assert_memory_equal(span[0].ptr, in, span[0].len);
+    assert_memory_equal(span[1].ptr, in + span[0].len, span[1].len);
+
+    CbReadCommit(&cb, span[0].len);
+    assert_int_equal(CbPeekSpans(&cb, span), span[0].len);
+    assert_int_equal(span[1].len, 0);
+    CbReadCommit(&cb, span[0].len);
+    assert_true(CbIsEmpty(&cb));
+    assert_int_equal(CbPeekSpans(&cb, span), 0);
+}
+
+static void test_write_reserve(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "reserve");
+    uint8_t skip[50] = {0}, out[20];
+    CbWrite(&cb, skip, sizeof skip);
+    CbRead(&cb, skip, sizeof skip);
+
+    cb_span_t span[2];
+    assert_int_equal(CbWriteReserve(&cb, span), TEST_CB_SZ - 1);
+    assert_int_equal(span[0].len, CbContiguousEmptyCount(&cb));
+    assert_int_equal(span[0].len, TEST_CB_SZ - sizeof skip);
+
+    size_t n = 0;
+    for(size_t s = 0; s < 2; ++s){
+        for(size_t i = 0; i < span[s].len && n < sizeof out; ++i) span[s].ptr[i] = (uint8_t)(n++);
+    }
+    CbWriteCommit(&cb, n);
+    assert_int_equal(CbDataCount(&cb), sizeof out);
+    assert_int_equal(CbRead(&cb, out, sizeof out), sizeof out);
+    for(size_t i = 0; i < sizeof out; ++i) assert_int_equal(out[i], i);
+}
+
+static void test_iov(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "iov");
+    CbSetPolicy(&cb, CB_POLICY_DROP_NEWEST);
+    uint8_t skip[50] = {0};
+    CbWrite(&cb, skip, sizeof skip);
+    CbRead(&cb, skip, sizeof skip);
+
+    // header + payload straddling the wrap point as one record
+    uint8_t hdr[4] = {0xA1, 0xA2, 0xA3, 0xA4}, pay[30];
+    for(size_t i = 0; i < sizeof pay; ++i) pay[i] = (uint8_t)i;
+    cb_iov_t wv[3] = { {hdr, sizeof hdr}, {NULL, 0}, {pay, sizeof pay} };
+    assert_int_equal(CbWritev(&cb, wv, 3), sizeof hdr + sizeof pay);
+    assert_int_equal(CbDataCount(&cb), sizeof hdr + sizeof pay);
+
+    // does not fit: nothing from any segment goes in
+    assert_int_equal(CbWritev(&cb, wv, 3), 0);
+    assert_int_equal(CbDataCount(&cb), sizeof hdr + sizeof pay);
+
+    // split on a different boundary than it was written with
+    uint8_t a[6], b[40];
+    cb_iov_t rv[2] = { {a, sizeof a}, {b, sizeof b} };
+    assert_int_equal(CbReadv(&cb, rv, 2), 0); // 46 > 34, all or nothing
+    assert_int_equal(CbDataCount(&cb), sizeof hdr + sizeof pay);
+    rv[1].iov_len = 28;
+    assert_int_equal(CbReadv(&cb, rv, 2), sizeof a + 28);
+    assert_memory_equal(a, hdr, sizeof hdr);
+    assert_int_equal(a[4], 0);
+    assert_int_equal(a[5], 1);
+    assert_memory_equal(b, pay + 2, 28);
+    assert_true(CbIsEmpty(&cb));
+}
+
+#ifdef CB_HAS_FDIO
+static void test_fd_io(void){
+    int p[2];
+    assert_int_equal(pipe(p), 0);
+    cb_t tx, rx;
+    static uint8_t rx_mem[TEST_CB_SZ];
+    CbInit(&tx, test_mem, TEST_CB_SZ, "tx");
+    CbInit(&rx, rx_mem, TEST_CB_SZ, "rx");
+    uint8_t skip[50] = {0}, in[40], out[40];
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(i + 1);
+
+    // both rings wrapped, so each side needs two iovecs
+    CbWrite(&tx, skip, sizeof skip); CbRead(&tx, skip, sizeof skip);
+    CbWrite(&rx, skip, 40);          CbRead(&rx, skip, 40);
+    assert_int_equal(CbWrite(&tx, in, sizeof in), sizeof in);
+    assert_int_equal(CbSendToFd(&tx, p[1]), sizeof in);
+    assert_true(CbIsEmpty(&tx));
+    assert_int_equal(CbSendToFd(&tx, p[1]), 0);
+    assert_int_equal(CbRecvFromFd(&rx, p[0]), sizeof in);
+    assert_int_equal(CbRead(&rx, out, sizeof out), sizeof in);
+    assert_memory_equal(in, out, sizeof in);
+
+    // the fd refuses: the data stays queued
+    fcntl(p[1], F_SETFL, O_NONBLOCK);
+    fcntl(p[0], F_SETFL, O_NONBLOCK);
+    static uint8_t junk[4096];
+    size_t stuffed = 0;
+    for(ssize_t w; (w = write(p[1], junk, sizeof junk)) > 0; ) stuffed += (size_t)w;
+    assert_int_equal(CbWrite(&tx, in, 10), 10);
+    assert_int_equal(CbSendToFd(&tx, p[1]), -1);
+    assert_int_equal(errno, EAGAIN);
+    assert_int_equal(CbDataCount(&tx), 10);
+    for(ssize_t r; (r = read(p[0], junk, sizeof junk)) > 0; ) stuffed -= (size_t)r;
+    assert_int_equal(stuffed, 0);
+    assert_int_equal(CbSendToFd(&tx, p[1]), 10);
+
+    // full ring: nothing is read from the fd
+    assert_int_equal(CbWrite(&rx, junk, TEST_CB_SZ - 1), TEST_CB_SZ - 1);
+    assert_int_equal(CbRecvFromFd(&rx, p[0]), -1);
+    assert_int_equal(errno, ENOBUFS);
+    CbRead(&rx, junk, TEST_CB_SZ);
+    assert_int_equal(CbRecvFromFd(&rx, p[0]), 10);
+    close(p[1]);
+    assert_int_equal(CbRecvFromFd(&rx, p[0]), 0); // EOF
+    close(p[0]);
+}
+#endif
+
+static void test_timestamps(void){
+    cb_t cb;
+    cb_ts_t ts;
+    cb_ts_entry_t ent[4];
+    CbInit(&cb, test_mem, TEST_CB_SZ, "ts");
+    assert_true(CbTsInit(&cb, &ts, ent, ARRAY_LEN(ent)));
+    uint8_t in[10] = {0}, out[32];
+    uint64_t t;
+    assert_false(CbOldestTs(&cb, &t));
+
+    test_clock_ns = 1000;
+    CbWrite(&cb, in, 10);
+    test_clock_ns = 2000;
+    cb_span_t span[2];
+    CbWriteReserve(&cb, span);
+    CbWriteCommit(&cb, 10);
+    test_clock_ns = 3000;
+    CbWrite(&cb, in, 10);
+    assert_true(CbOldestTs(&cb, &t));
+    assert_int_equal(t, 1000);
+
+    // oldest byte read at 5000 arrived at 1000
+    test_clock_ns = 5000;
+    assert_int_equal(CbRead(&cb, out, 4), 4);
+    assert_true(CbOldestTs(&cb, &t));
+    assert_int_equal(t, 1000);
+    test_clock_ns = 6000;
+    assert_int_equal(CbRead(&cb, out, 10), 10); // 6..15 -> from the 1000 chunk
+    assert_true(CbOldestTs(&cb, &t));
+    assert_int_equal(t, 2000);
+    test_clock_ns = 6100;
+    assert_int_equal(CbRead(&cb, out, sizeof out), 16);
+    assert_false(CbOldestTs(&cb, &t));
+
+    assert_int_equal(ts.lat_cnt, 3);
+    assert_int_equal(ts.lat_max, 5000);
+    assert_int_equal(ts.lat_sum, 4000 + 5000 + 4100);
+    assert_int_equal(CbLatPercentile(&ts, 50), 8191);   // 5000 in [4096, 8192)
+    assert_int_equal(CbLatPercentile(&ts, 0), 4095);    // 4000 in [2048, 4096)
+
+    // side-ring full: later chunks are charged to the last stamp
+    for(size_t i = 0; i < 6; ++i){ test_clock_ns = 10000 + i; CbWrite(&cb, in, 5); }
+    assert_int_equal(ts.merged, 2);
+    for(size_t i = 0; i < 6; ++i){
+        assert_true(CbOldestTs(&cb, &t));
+        assert_int_equal(t, 10000 + ((i < 4) ? i : 3));
+        CbRead(&cb, out, 5);
+    }
+    CbLatReset(&ts);
+    assert_int_equal(CbLatPercentile(&ts, 99), 0);
+}
+
+static int wm_highs, wm_lows;
+static void wm_on_high(cb_t * cb, void * ctx){ (void)cb; assert_ptr_equal(ctx, &wm_highs); wm_highs++; }
+static void wm_on_low(cb_t * cb, void * ctx){ (void)cb; (void)ctx; wm_lows++; }
+
+static void test_watermarks(void){
+    cb_t cb;
+    cb_wm_t wm;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "wm");
+    wm_highs = wm_lows = 0;
+    assert_true(CbWatermarkInit(&cb, &wm, .high = 40, .low = 10,
+                                .on_high = wm_on_high, .on_low = wm_on_low, .ctx = &wm_highs,
+                                .eventfd = true));
+    uint8_t in[10] = {0}, out[10];
+    for(int i = 0; i < 3; ++i) CbWrite(&cb, in, 10);
+    assert_int_equal(wm_highs, 0);
+    CbWrite(&cb, in, 10); // 40: edge
+    CbWrite(&cb, in, 10); // still above, no new edge
+    assert_int_equal(wm_highs, 1);
+    assert_true(CbAboveHigh(&cb));
+
+    // draining below high is not enough, low must be reached
+    for(int i = 0; i < 3; ++i) CbRead(&cb, out, 10);
+    assert_int_equal(wm_lows, 0);
+    CbWrite(&cb, in, 10); // back to 30: under high, already above, nothing
+    assert_int_equal(wm_highs, 1);
+    CbRead(&cb, out, 10);
+    CbRead(&cb, out, 10); // 10: edge
+    assert_int_equal(wm_lows, 1);
+    assert_false(CbAboveHigh(&cb));
+    CbRead(&cb, out, 10);
+    assert_int_equal(wm_lows, 1);
+
+    uint8_t big[45] = {0};
+    CbWrite(&cb, big, sizeof big);
+    assert_int_equal(wm_highs, 2);
+    assert_int_equal(wm.highs, 2);
+    assert_int_equal(wm.lows, 1);
+#ifdef CB_HAS_WAIT
+    uint64_t edges = 0;
+    assert_int_equal(read(CbWatermarkFd(&cb), &edges, sizeof edges), sizeof edges);
+    assert_int_equal(edges, 3);
+#endif
+    CbWatermarkClose(&cb);
+    assert_null(cb.wm);
+}
+
+#ifdef CB_HAS_MIRRORED
+static void test_spill(void){
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/cb_spill_%d", (int)getpid());
+    cb_t cb;
+    cb_spill_t sp;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "spill");
+    assert_true(CbSpillInit(&sp, &cb, path, 4096, .high_wm = 32));
+
+    // 30 bytes stay in memory, the rest goes to the file
+    uint8_t in[10], out[16];
+    for(size_t k = 0; k < 30; ++k){
+        for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(k * 10 + i);
+        assert_int_equal(CbSpillWrite(&sp, in, sizeof in), sizeof in);
+    }
+    assert_int_equal(CbDataCount(&cb), 30);
+    assert_int_equal(CbSpillCount(&sp), 270);
+    assert_int_equal(sp.episodes, 1);
+
+    // memory is drained first, then the journal, in write order
+    size_t pos = 0, got;
+    while(pos < 150 && (got = CbSpillRead(&sp, out, sizeof out)) > 0){
+        for(size_t i = 0; i < got; ++i) assert_int_equal(out[i], (uint8_t)(pos + i));
+        pos += got;
+    }
+    // memory has room again, but order keeps new data behind the journal
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(300 + i);
+    assert_int_equal(CbSpillWrite(&sp, in, sizeof in), sizeof in);
+    assert_true(CbIsEmpty(&cb));
+    while((got = CbSpillRead(&sp, out, sizeof out)) > 0){
+        for(size_t i = 0; i < got; ++i) assert_int_equal(out[i], (uint8_t)(pos + i));
+        pos += got;
+    }
+    assert_int_equal(pos, 310);
+
+    // journal drained: back to memory
+    assert_int_equal(CbSpillWrite(&sp, in, sizeof in), sizeof in);
+    assert_int_equal(CbDataCount(&cb), sizeof in);
+    assert_int_equal(CbSpillCount(&sp), 0);
+    assert_int_equal(sp.spilled, 280);
+
+    // both full: refused, nothing overwritten
+    static uint8_t big[1000];
+    while(CbSpillWrite(&sp, big, sizeof big)){}
+    assert_int_equal(sp.refused, sizeof big);
+    assert_int_equal(CbRead(&cb, out, sizeof in), sizeof in);
+    assert_memory_equal(out, in, sizeof in);
+
+    CbSpillClose(&sp);
+    unlink(path);
+}
+
+static void test_spill_replay(void){
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/cb_spill_replay_%d", (int)getpid());
+    unlink(path);
+    cb_t cb;
+    cb_spill_t sp;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "spill");
+    assert_true(CbSpillInit(&sp, &cb, path, 4096, .high_wm = 8));
+
+    uint8_t in[100], out[100];
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)i;
+    assert_int_equal(CbSpillWrite(&sp, in, 8), 8);        // memory
+    assert_int_equal(CbSpillWrite(&sp, in + 8, 92), 92);  // journal
+    assert_int_equal(CbSpillRead(&sp, out, 8), 8);
+    assert_int_equal(CbSpillRead(&sp, out, 30), 30);      // 8..37 from the journal
+    CbSpillClose(&sp);
+
+    // restart: the 62 unread journal bytes come back before anything new
+    CbInit(&cb, test_mem, TEST_CB_SZ, "spill");
+    assert_true(CbSpillInit(&sp, &cb, path, 4096, .high_wm = 8));
+    assert_int_equal(CbSpillCount(&sp), 62);
+    uint8_t late = 0xEE;
+    assert_int_equal(CbSpillWrite(&sp, &late, 1), 1);
+    assert_true(CbIsEmpty(&cb));
+    assert_int_equal(CbSpillRead(&sp, out, sizeof out), 63);
+    assert_memory_equal(out, in + 38, 62);
+    assert_int_equal(out[62], 0xEE);
+    CbSpillClose(&sp);
+
+    // another size does not trust the old contents
+    assert_true(CbSpillInit(&sp, &cb, path, 8192, .high_wm = 8));
+    assert_int_equal(CbSpillCount(&sp), 0);
+    CbSpillClose(&sp);
+    unlink(path);
+}
+
+static void test_mirrored(void){
+    cb_t cb;
+    const size_t sz = 1u << 16;
+    assert_true(CbInitMirrored(&cb, sz, "mirror"));
+    assert_true(cb.mirrored);
+
+    // both halves alias the same memory (volatile: the compiler cannot know that)
+    volatile uint8_t *v = cb.data;
+    v[5] = 0x5A;
+    assert_int_equal(v[sz + 5], 0x5A);
+
+    static uint8_t in[1000], out[1000], skip[1u << 15];
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)(i * 7);
+    for(int k = 0; k < 3; ++k){
+        assert_int_equal(CbWrite(&cb, skip, sizeof skip), sizeof skip);
+        assert_int_equal(CbRead(&cb, skip, sizeof skip), sizeof skip);
+    }
+    assert_int_equal(CbWrite(&cb, in, sizeof in), sizeof in);
+
+    // the write wrapped but is still seen as a single span
+    cb_span_t span[2];
+    assert_int_equal(CbPeekSpans(&cb, span), sizeof in);
+    assert_int_equal(span[0].len, sizeof in);
+    assert_int_equal(span[1].len, 0);
+    assert_memory_equal(span[0].ptr, in, sizeof in);
+
+    assert_int_equal(CbRead(&cb, out, sizeof out), sizeof out);
+    assert_memory_equal(in, out, sizeof in);
+
+    CbFreeMirrored(&cb);
+    assert_null(cb.data);
+    assert_false(CbInitMirrored(&cb, 64, "too_small"));
+}
+#endif // CB_HAS_MIRRORED
+
+// sync 0xAA55, 16 bit big endian length, payload, CRC-16 big endian
+static size_t frame_build(uint8_t * out, const uint8_t * payload, uint16_t len){
+    out[0] = 0xAA; out[1] = 0x55;
+    out[2] = (uint8_t)(len >> 8); out[3] = (uint8_t)len;
+    memcpy(out + 4, payload, len);
+    uint16_t crc = CbCrc16(0xFFFF, out + 2, 2u + len);
+    out[4 + len] = (uint8_t)(crc >> 8);
+    out[5 + len] = (uint8_t)crc;
+    return 6u + len;
+}
+
+static void test_frame_decoder(void){
+    static uint8_t mem[256];
+    cb_t cb;
+    cb_frame_dec_t dec;
+    cb_frame_t fr;
+    uint8_t buf[64], pay[32];
+    CbInit(&cb, mem, sizeof mem, "frames");
+    CbFrameInit(&dec, &cb, .sync = 0xAA55, .sync_len = 2, .len_off = 2, .len_sz = 2,
+                .crc = CB_CRC16_CCITT, .max_payload = 40);
+
+    assert_int_equal(CbCrc16(0xFFFF, (const uint8_t*)"123456789", 9), 0x29B1);
+    assert_true(CbCrc32(0, (const uint8_t*)"123456789", 9) == 0xCBF43926u);
+
+    for(size_t i = 0; i < sizeof pay; ++i) pay[i] = (uint8_t)(i * 5);
+    const uint8_t garbage[] = { 0x01, 0xAA, 0x02, 0x55 };
+
+    // garbage, good frame, corrupted frame, good frame
+    CbWrite(&cb, garbage, sizeof garbage);
+    size_t n = frame_build(buf, pay, 10);
+    CbWrite(&cb, buf, n);
+    n = frame_build(buf, pay, 20);
+    buf[8] ^= 0xFF;
+    CbWrite(&cb, buf, n);
+    n = frame_build(buf, pay, 30);
+    CbWrite(&cb, buf, n);
+
+    assert_true(CbFrameNext(&dec, &fr));
+    assert_int_equal(fr.payload_len, 10);
+    assert_int_equal(fr.len, 16);
+    assert_memory_equal(fr.span[0].ptr + fr.payload_off, pay, 10);
+
+    assert_true(CbFrameNext(&dec, &fr));
+    assert_int_equal(fr.payload_len, 30);
+    uint8_t out[32];
+    assert_int_equal(CbFramePayload(&fr, out, sizeof out), 30);
+    assert_memory_equal(out, pay, 30);
+    assert_false(CbFrameNext(&dec, &fr));
+
+    assert_int_equal(dec.frames, 2);
+    assert_int_equal(dec.crc_errors, 1);
+    assert_true(dec.resyncs >= 2);
+    assert_true(CbIsEmpty(&cb));
+
+    // frame split by the wrap and delivered in two DMA-sized pieces
+    uint8_t skip[256] = {0};
+    size_t k = CbContiguousEmptyCount(&cb) - 6;
+    CbWrite(&cb, skip, k);
+    CbRead(&cb, skip, k);
+    n = frame_build(buf, pay, 25);
+    CbWrite(&cb, buf, 10);
+    assert_false(CbFrameNext(&dec, &fr));
+    CbWrite(&cb, buf + 10, n - 10);
+    assert_true(CbFrameNext(&dec, &fr));
+    assert_true(fr.span[1].len > 0);
+    assert_int_equal(CbFramePayload(&fr, out, sizeof out), 25);
+    assert_memory_equal(out, pay, 25);
+
+    // length above max_payload
+    CbFrameRelease(&dec);
+    buf[2] = 0x01;
+    CbWrite(&cb, buf, 6);
+    assert_false(CbFrameNext(&dec, &fr));
+    assert_int_equal(dec.len_errors, 1);
+}
+
+static void test_msg(void){
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "msg");
+    cb_msg_t msg;
+    uint8_t out[32];
+
+    assert_false(CbPeekMsg(&cb, &msg));
+    assert_true(CbPushMsg(&cb, "hello", 5, 0));                 // 16 bytes
+    assert_true(CbPushMsg(&cb, "world!", 6, .ts = 1234));       // 24 bytes
+    assert_true(CbPushMsg(&cb, NULL, 0, 0));                    // 8 bytes
+
+    assert_true(CbPeekMsg(&cb, &msg));
+    assert_int_equal(msg.len, 5);
+    assert_int_equal(msg.ts, 0);
+    assert_memory_equal(msg.data, "hello", 5);
+    CbDropMsg(&cb);
+
+    assert_true(CbPopMsg(&cb, out, 3, &msg));
+    assert_int_equal(msg.len, 6);
+    assert_int_equal(msg.ts, 1234);
+    assert_memory_equal(out, "wor", 3);
+
+    assert_true(CbPopMsg(&cb, out, sizeof out, &msg));
+    assert_int_equal(msg.len, 0);
+    assert_false(CbPopMsg(&cb, out, sizeof out, &msg));
+
+    // write at 48: 20 byte payload needs 24, tail of 16 gets skipped
+    uint8_t big[20];
+    for(size_t i = 0; i < sizeof big; ++i) big[i] = (uint8_t)(0xA0 + i);
+    assert_true(CbPushMsg(&cb, big, sizeof big, 0));
+    assert_true(CbPeekMsg(&cb, &msg));
+    assert_ptr_equal(msg.data, test_mem + sizeof(uint32_t));
+    assert_int_equal(msg.len, sizeof big);
+    assert_memory_equal(msg.data, big, sizeof big);
+    CbDropMsg(&cb);
+    assert_true(CbIsEmpty(&cb));
+
+    // does not fit at all
+    uint8_t huge[TEST_CB_SZ] = {0};
+    size_t full = cb.full_cnt;
+    assert_false(CbPushMsg(&cb, huge, sizeof huge - 8, 0));
+    assert_int_equal(cb.full_cnt, full + 1);
+}
+
+typedef struct{
+    uint16_t a;
+    uint16_t b;
+    uint32_t c;
+}sample_t;
+
+CB_DECLARE(SampleCb, sample_t)
+
+static void test_typed(void){
+    static sample_t mem[8];
+    SampleCb_t cb;
+    SampleCbInit(&cb, mem, ARRAY_LEN(mem), "typed");
+
+    sample_t in[12], out[12];
+    for(uint16_t i = 0; i < 12; ++i) in[i] = (sample_t){ .a = i, .b = (uint16_t)(i * 2), .c = i * 1000u };
+
+    assert_true(SampleCbPush(&cb, &in[0]));
+    assert_int_equal(SampleCbPushN(&cb, &in[1], 4), 4);
+    assert_int_equal(SampleCbCount(&cb), 5);
+    assert_int_equal(SampleCbPopN(&cb, out, 3), 3);
+    assert_memory_equal(in, out, 3 * sizeof(sample_t));
+
+    // wraps; capacity is the whole size and extra records are refused
+    assert_int_equal(SampleCbPushN(&cb, &in[5], 7), 6);
+    assert_int_equal(SampleCbFree(&cb), 0);
+    assert_int_equal(cb.full_cnt, 1);
+    assert_false(SampleCbPush(&cb, &in[11]));
+
+    SampleCb_span_t span[2];
+    assert_int_equal(SampleCbPeekSpans(&cb, span), 8);
+    assert_int_equal(span[0].len, 5);
+    assert_int_equal(span[1].len, 3);
+    assert_int_equal(span[0].ptr[0].a, 3);
+    assert_int_equal(span[1].ptr[2].c, 10000);
+    SampleCbReadCommit(&cb, 5);
+
+    assert_true(SampleCbPop(&cb, &out[0]));
+    assert_int_equal(out[0].a, 8);
+    assert_int_equal(SampleCbPopN(&cb, out, 12), 2);
+    assert_int_equal(out[1].b, 20);
+    assert_int_equal(SampleCbCount(&cb), 0);
+}
+
+#if defined(CB_HAS_WAIT) && defined(CB_SPSC)
+#include <poll.h>
+
+static cb_t wait_cb;
+
+static void * wait_writer(void * arg){
+    (void)arg;
+    uint8_t b[4] = {1, 2, 3, 4};
+    for(int i = 0; i < 3; ++i){
+        usleep(5000);
+        CbWrite(&wait_cb, b, sizeof b);
+    }
+    return NULL;
+}
+
+static void * wait_reader(void * arg){
+    (void)arg;
+    uint8_t b[16];
+    usleep(5000);
+    CbRead(&wait_cb, b, sizeof b);
+    return NULL;
+}
+
+static void test_wait(void){
+    static cb_notify_t ntf;
+    CbInit(&wait_cb, test_mem, TEST_CB_SZ, "wait");
+    assert_true(CbNotifyInit(&wait_cb, &ntf, .high_wm = 8, .eventfd = true));
+    int fd = CbNotifyFd(&wait_cb);
+    assert_true(fd >= 0);
+
+    // nothing arrives: times out
+    assert_false(CbWaitReadable(&wait_cb, 1, 20));
+
+    // woken once the third chunk brings 12 bytes
+    pthread_t th;
+    pthread_create(&th, NULL, wait_writer, NULL);
+    assert_true(CbWaitReadable(&wait_cb, 10, 2000));
+    assert_true(CbDataCount(&wait_cb) >= 10);
+    pthread_join(th, NULL);
+
+    // eventfd counted empty->non-empty and the high_wm crossing
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    assert_int_equal(poll(&pfd, 1, 0), 1);
+    uint64_t cnt = 0;
+    assert_int_equal(read(fd, &cnt, sizeof cnt), sizeof cnt);
+    assert_int_equal(cnt, 2);
+
+    // writer side: full ring, a reader frees space
+    uint8_t fill[TEST_CB_SZ] = {0};
+    CbWrite(&wait_cb, fill, CbEmptyCount(&wait_cb));
+    assert_int_equal(CbEmptyCount(&wait_cb), 0);
+    pthread_create(&th, NULL, wait_reader, NULL);
+    assert_true(CbWaitWritable(&wait_cb, 16, 2000));
+    pthread_join(th, NULL);
+
+    // block-producer policy parks CbWrite the same way
+    CbWrite(&wait_cb, fill, CbEmptyCount(&wait_cb));
+    CbSetPolicy(&wait_cb, CB_POLICY_BLOCK);
+    pthread_create(&th, NULL, wait_reader, NULL);
+    assert_int_equal(CbWrite(&wait_cb, fill, 16), 16);
+    pthread_join(th, NULL);
+    assert_int_equal(CbStats(&wait_cb).bytes_dropped, 0);
+
+    CbNotifyClose(&wait_cb);
+    assert_null(wait_cb.ntf);
+}
+#endif // CB_HAS_WAIT && CB_SPSC
+
+#define MPMC_SZ         256
+#define MPMC_PRODUCERS  4
+#define MPMC_CONSUMERS  2
+#define MPMC_PER_PROD   50000
+
+static size_t mpmc_mem[CB_MPMC_MEM_SZ(MPMC_SZ, sizeof(uint64_t)) / sizeof(size_t)];
+static cb_mpmc_t mpmc;
+static _Atomic uint64_t mpmc_sum;
+static _Atomic size_t mpmc_popped;
+
+static void test_mpmc(void){
+    CbMpmcInit(&mpmc, mpmc_mem, 8, sizeof(uint32_t), "mpmc");
+    uint32_t in[10], out[10] = {0};
+    for(uint32_t i = 0; i < 10; ++i) in[i] = i * 3;
+
+    assert_false(CbMpmcPop(&mpmc, out));
+    assert_true(CbMpmcPush(&mpmc, &in[0]));
+    assert_int_equal(CbMpmcPushN(&mpmc, &in[1], 9), 7); // capacity is count
+    assert_false(CbMpmcPush(&mpmc, &in[9]));
+
+    assert_true(CbMpmcPop(&mpmc, &out[0]));
+    assert_int_equal(out[0], 0);
+    assert_int_equal(CbMpmcPopN(&mpmc, &out[1], 10), 7);
+    assert_memory_equal(in, out, 8 * sizeof(uint32_t));
+    assert_int_equal(CbMpmcPopN(&mpmc, out, 10), 0);
+}
+
+static void * mpmc_producer(void * arg){
+    uint64_t base = (uint64_t)(uintptr_t)arg * MPMC_PER_PROD;
+    uint64_t batch[8];
+    size_t i = 0;
+    while(i < MPMC_PER_PROD){
+        size_t n = 0;
+        for(; n < ARRAY_LEN(batch) && i + n < MPMC_PER_PROD; ++n) batch[n] = base + i + n + 1;
+        size_t sent = CbMpmcPushN(&mpmc, batch, n);
+        if(sent == 0) sched_yield();
+        i += sent;
+    }
+    return NULL;
+}
+
+static void * mpmc_consumer(void * arg){
+    (void)arg;
+    uint64_t batch[8];
+    while(atomic_load(&mpmc_popped) < (size_t)MPMC_PRODUCERS * MPMC_PER_PROD){
+        size_t got = CbMpmcPopN(&mpmc, batch, ARRAY_LEN(batch));
+        if(got == 0){ sched_yield(); continue; }
+        uint64_t sum = 0;
+        for(size_t i = 0; i < got; ++i) sum += batch[i];
+        atomic_fetch_add(&mpmc_sum, sum);
+        atomic_fetch_add(&mpmc_popped, got);
+    }
+    return NULL;
+}
+
+static void test_mpmc_threads(void){
+    CbMpmcInit(&mpmc, mpmc_mem, MPMC_SZ, sizeof(uint64_t), "mpmc_threads");
+    atomic_store(&mpmc_sum, 0);
+    atomic_store(&mpmc_popped, 0);
+
+    pthread_t prod[MPMC_PRODUCERS], cons[MPMC_CONSUMERS];
+    for(uintptr_t i = 0; i < MPMC_CONSUMERS; ++i) pthread_create(&cons[i], NULL, mpmc_consumer, NULL);
+    for(uintptr_t i = 0; i < MPMC_PRODUCERS; ++i) pthread_create(&prod[i], NULL, mpmc_producer, (void *)i);
+    for(size_t i = 0; i < MPMC_PRODUCERS; ++i) pthread_join(prod[i], NULL);
+    for(size_t i = 0; i < MPMC_CONSUMERS; ++i) pthread_join(cons[i], NULL);
+
+    // every value 1..N exactly once
+    uint64_t n = (uint64_t)MPMC_PRODUCERS * MPMC_PER_PROD;
+    assert_int_equal(atomic_load(&mpmc_popped), n);
+    assert_true(atomic_load(&mpmc_sum) == n * (n + 1) / 2);
+}
+
+static void test_bcast(void){
+    static cb_bcast_t bc;
+    cb_reader_t rd[3];
+    uint8_t in[24], out[64];
+    size_t lost = 0;
+    for(size_t i = 0; i < sizeof in; ++i) in[i] = (uint8_t)i;
+
+    // overrun mode: the producer never waits
+    CbBcastInit(&bc, test_mem, TEST_CB_SZ, rd, 3, false, "bcast");
+    assert_int_equal(CbBcastWrite(&bc, in, sizeof in), sizeof in);
+    assert_int_equal(CbBcastRead(&bc, 0, out, sizeof out, &lost), sizeof in);
+    assert_int_equal(lost, 0);
+    assert_memory_equal(out, in, sizeof in);
+    assert_int_equal(CbBcastRead(&bc, 1, out, 10, &lost), 10);
+    assert_int_equal(CbBcastDataCount(&bc, 0), 0);
+    assert_int_equal(CbBcastDataCount(&bc, 1), sizeof in - 10);
+    assert_int_equal(CbBcastDataCount(&bc, 2), sizeof in);
+
+    CbBcastWrite(&bc, in, sizeof in);
+    CbBcastWrite(&bc, in, sizeof in); // 72 bytes written, reader 2 pushed to 9
+    assert_int_equal(CbBcastRead(&bc, 2, out, sizeof out, &lost), TEST_CB_SZ - 1);
+    assert_int_equal(lost, 3 * sizeof in - (TEST_CB_SZ - 1));
+    assert_int_equal(out[TEST_CB_SZ - 2], in[sizeof in - 1]);
+    assert_int_equal(CbBcastRead(&bc, 1, out, sizeof out, &lost), 3 * sizeof in - 10);
+    assert_int_equal(lost, 0);
+    assert_int_equal(CbBcastRead(&bc, 0, out, sizeof out, &lost), 2 * sizeof in);
+
+    // gated: the slowest reader holds the producer back, a detached one does not
+    CbBcastInit(&bc, test_mem, TEST_CB_SZ, rd, 3, true, "bcast_gate");
+    CbBcastWrite(&bc, in, sizeof in);
+    CbBcastWrite(&bc, in, sizeof in);
+    CbBcastRead(&bc, 0, out, sizeof out, NULL);
+    CbBcastRead(&bc, 1, out, sizeof out, NULL);
+    assert_int_equal(CbBcastWrite(&bc, in, sizeof in), 0);
+    assert_int_equal(bc.full_cnt, 1);
+    CbBcastDetach(&bc, 2);
+    assert_int_equal(CbBcastWrite(&bc, in, sizeof in), sizeof in);
+    CbBcastAttach(&bc, 2);
+    assert_int_equal(CbBcastDataCount(&bc, 2), 0);
+
+    // zero-copy reader
+    cb_span_t span[2];
+    assert_int_equal(CbBcastPeekSpans(&bc, 0, span), sizeof in);
+    assert_memory_equal(span[0].ptr, in, span[0].len);
+    assert_true(CbBcastCommit(&bc, 0, sizeof in));
+}
+
+#define BCAST_BYTES (32u << 20)
+
+static cb_bcast_t bcast_mt;
+
+static void * bcast_reader(void * arg){
+    size_t id = (size_t)(uintptr_t)arg, pos = 0, bad = 0, lost;
+    uint8_t out[1024];
+    while(pos < BCAST_BYTES){
+        size_t got = CbBcastRead(&bcast_mt, id, out, (id == 0) ? sizeof out : 17, &lost);
+        pos += lost;
+        for(size_t i = 0; i < got; ++i) bad += (out[i] != (uint8_t)((pos + i) * 13));
+        pos += got;
+        if(got == 0) sched_yield();
+    }
+    return (void *)(uintptr_t)bad;
+}
+
+static void test_bcast_threads(void){
+    static uint8_t mem[4096];
+    static cb_reader_t rd[2];
+    CbBcastInit(&bcast_mt, mem, sizeof mem, rd, 2, false, "bcast_mt");
+
+    pthread_t th[2];
+    for(uintptr_t i = 0; i < 2; ++i) pthread_create(&th[i], NULL, bcast_reader, (void *)i);
+    uint8_t chunk[300];
+    for(size_t pos = 0; pos < BCAST_BYTES + sizeof mem; pos += sizeof chunk){
+        for(size_t i = 0; i < sizeof chunk; ++i) chunk[i] = (uint8_t)((pos + i) * 13);
+        CbBcastWrite(&bcast_mt, chunk, sizeof chunk);
+        if((pos & 0xFFFF) == 0) sched_yield();
+    }
+    // every byte a reader kept matches its absolute position: no torn reads
+    for(size_t i = 0; i < 2; ++i){
+        void *bad;
+        pthread_join(th[i], &bad);
+        assert_int_equal((uintptr_t)bad, 0);
+    }
+}
+
+#ifdef CB_SPSC
+
+#define STRESS_CB_SZ   (1u << 16)
+#define STRESS_BYTES   (256ull << 20)
+#define STRESS_CHUNK   4096
+
+static uint8_t stress_mem[STRESS_CB_SZ];
+static cb_t stress_cb;
+
+static inline uint8_t stress_pattern(uint64_t i){
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16) ^ (i >> 24));
+}
+
+static void * stress_producer(void * arg){
+    (void)arg;
+    uint8_t chunk[STRESS_CHUNK];
+    uint64_t pos = 0;
+    while(pos < STRESS_BYTES){
+        size_t n = (size_t)(1 + (pos % (STRESS_CHUNK - 1)));
+        if(n > STRESS_BYTES - pos) n = (size_t)(STRESS_BYTES - pos);
+        for(size_t i = 0; i < n; ++i) chunk[i] = stress_pattern(pos + i);
+        while(CbWrite(&stress_cb, chunk, n) == 0){ sched_yield(); }
+        pos += n;
+    }
+    return NULL;
+}
+
+// checks ordering and integrity only, throughput is measured by cb_bench
+static void test_spsc_stress(void){
+    CbInit(&stress_cb, stress_mem, STRESS_CB_SZ, "stress");
+    stress_cb.full_cnt = 0;
+
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, stress_producer, NULL), 0);
+
+    uint8_t out[STRESS_CHUNK];
+    uint64_t pos = 0;
+    size_t bad = 0;
+    while(pos < STRESS_BYTES){
+        size_t got = CbRead(&stress_cb, out, sizeof out);
+        if(got == 0){ sched_yield(); continue; }
+        for(size_t i = 0; i < got; ++i){
+            bad += (out[i] != stress_pattern(pos + i));
+        }
+        pos += got;
+    }
+    pthread_join(th, NULL);
+
+    assert_int_equal(bad, 0);
+    assert_true(CbIsEmpty(&stress_cb));
+}
+#endif // CB_SPSC
+
+#ifdef CB_IDX_CACHE
+static void test_idx_cache(void){
+    // producer and consumer indices never share a line
+    assert_true(offsetof(cb_t, write) / CB_CACHELINE_SZ != offsetof(cb_t, read) / CB_CACHELINE_SZ);
+    assert_true(offsetof(cb_t, read_cache) / CB_CACHELINE_SZ == offsetof(cb_t, write) / CB_CACHELINE_SZ);
+    assert_true(offsetof(cb_t, write_cache) / CB_CACHELINE_SZ == offsetof(cb_t, read) / CB_CACHELINE_SZ);
+
+    cb_t cb;
+    CbInit(&cb, test_mem, TEST_CB_SZ, "cache");
+    uint8_t in[40] = {1}, out[40];
+    assert_int_equal(CbWrite(&cb, in, 10), 10);
+    assert_int_equal(CbRead(&cb, out, 4), 4);
+    assert_int_equal(cb.write_cache, 10);
+    // the consumer's copy covers the next read, write is not reloaded
+    assert_int_equal(CbWrite(&cb, in, 20), 20);
+    assert_int_equal(CbRead(&cb, out, 6), 6);
+    assert_int_equal(cb.write_cache, 10);
+    // a longer read refreshes it and sees everything
+    assert_int_equal(CbRead(&cb, out, sizeof out), 20);
+    assert_int_equal(cb.write_cache, 30);
+
+    // the producer reloads read when its copy runs short or to confirm a new
+    // fill peak (from the cached copy the level is an upper bound), so the
+    // high watermark is exact: 10 written, 4 read, 20 written
+    assert_int_equal(CbStats(&cb).high_watermark, 26);
+    assert_int_equal(cb.read_cache, 4);
+    assert_int_equal(CbWrite(&cb, in, 10), 10);   // estimate 36: confirmed as 10
+    assert_int_equal(cb.read_cache, 30);
+    assert_int_equal(CbRead(&cb, out, 5), 5);
+    assert_int_equal(CbWrite(&cb, in, 10), 10);   // estimate 20 < 26: no reload
+    assert_int_equal(cb.read_cache, 30);
+    assert_int_equal(CbStats(&cb).high_watermark, 26);
+    assert_int_equal(CbWrite(&cb, in, 40), 40);   // real peak 55
+    assert_int_equal(CbStats(&cb).high_watermark, 55);
+    assert_int_equal(CbWrite(&cb, in, 40), 0);
+    assert_int_equal(CbStats(&cb).full_cnt, 1);
+}
+#endif
+
+#ifdef CB_PACKED_LAYOUT
+static void test_packed_layout(void){
+    // the baseline really shares: indices and counters on one line
+    size_t line = offsetof(cb_t, write) / CB_CACHELINE_SZ;
+    assert_int_equal(offsetof(cb_t, write) % CB_CACHELINE_SZ, 0);
+    assert_int_equal(offsetof(cb_t, read) / CB_CACHELINE_SZ, line);
+    assert_int_equal(offsetof(cb_t, full_cnt) / CB_CACHELINE_SZ, line);
+    assert_int_equal(offsetof(cb_t, read_stalls) / CB_CACHELINE_SZ, line);
+}
+#endif
+
+#ifdef CB_HAS_SHARED
+#define SHM_SZ      (16u << 10)
+#define SHM_BYTES   (4u << 20)
+
+static void test_shared(void){
+    char name[32];
+    snprintf(name, sizeof name, "/cb_test_%d", (int)getpid());
+    CbUnlinkShared(name);
+    cb_t *cb = CbCreateShared(name, SHM_SZ);
+    assert_non_null(cb);
+    assert_null(cb->data);
+    assert_null(CbCreateShared(name, 2 * SHM_SZ)); // size mismatch
+    // process-local attachments are refused, the peer cannot follow them
+    cb_ts_t ts;
+    cb_ts_entry_t ent[16];
+    assert_false(CbTsInit(cb, &ts, ent, ARRAY_LEN(ent)));
+    assert_null(cb->ts);
+    cb_wm_t wm;
+    assert_false(CbWatermarkInit(cb, &wm, .high = 64));
+    assert_null(cb->wm);
+
+    pid_t pid = fork();
+    assert_true(pid >= 0);
+    if(pid == 0){
+        // consumer process: its own mapping, at another address
+        cb_t *rx = CbOpenShared(name);
+        if(!rx) _exit(2);
+        uint8_t out[1000];
+        size_t pos = 0, bad = 0;
+        while(pos < SHM_BYTES){
+            size_t got = CbRead(rx, out, sizeof out);
+            if(got == 0){ sched_yield(); continue; }
+            for(size_t i = 0; i < got; ++i) bad += (out[i] != (uint8_t)((pos + i) * 7));
+            pos += got;
+        }
+        CbCloseShared(rx);
+        _exit(bad ? 1 : 0);
+    }
+
+    uint8_t chunk[777];
+    for(size_t pos = 0; pos < SHM_BYTES; ){
+        size_t n = (SHM_BYTES - pos < sizeof chunk) ? SHM_BYTES - pos : sizeof chunk;
+        for(size_t i = 0; i < n; ++i) chunk[i] = (uint8_t)((pos + i) * 7);
+        if(CbWrite(cb, chunk, n) == 0){ sched_yield(); continue; }
+        pos += n;
+    }
+    int st = -1;
+    assert_int_equal(waitpid(pid, &st, 0), pid);
+    assert_true(WIFEXITED(st));
+    assert_int_equal(WEXITSTATUS(st), 0);
+    assert_true(CbIsEmpty(cb));
+
+    // a restarted producer finds the queued data where it left it
+    assert_int_equal(CbWrite(cb, (const uint8_t *)"abc", 3), 3);
+    CbCloseShared(cb);
+    cb = CbCreateShared(name, SHM_SZ);
+    assert_non_null(cb);
+    uint8_t out[8];
+    assert_int_equal(CbRead(cb, out, sizeof out), 3);
+    assert_memory_equal(out, "abc", 3);
+    CbCloseShared(cb);
+    assert_true(CbUnlinkShared(name));
+    assert_null(CbOpenShared(name));
+}
+
+static void test_shared_recover(void){
+    char name[32];
+    snprintf(name, sizeof name, "/cb_test_rc_%d", (int)getpid());
+    CbUnlinkShared(name);
+
+    // creator dies halfway through building the segment
+    pid_t pid = fork();
+    assert_true(pid >= 0);
+    if(pid == 0){
+        cb_t *cb = CbCreateShared(name, SHM_SZ);
+        if(!cb) _exit(2);
+        cb_shm_t *shm = (cb_shm_t *)((uint8_t *)cb - offsetof(cb_shm_t, cb));
+        atomic_store(&shm->ready, 0);
+        _exit(0);
+    }
+    int st = -1;
+    assert_int_equal(waitpid(pid, &st, 0), pid);
+    assert_int_equal(WEXITSTATUS(st), 0);
+
+    assert_null(CbOpenShared(name)); // not ready
+    cb_t *cb = CbCreateShared(name, SHM_SZ);
+    assert_non_null(cb);
+
+    // a reader index past the writer is pulled back on the next attach
+    assert_int_equal(CbWrite(cb, (const uint8_t *)"xyz", 3), 3);
+    CB_STORE_REL(cb->read, 100);
+    cb_t *rx = CbOpenShared(name);
+    assert_non_null(rx);
+    assert_int_equal(CB_LOAD_ACQ(rx->read), 3);
+    assert_true(CbIsEmpty(rx));
+    CbCloseShared(rx);
+    CbCloseShared(cb);
+    assert_true(CbUnlinkShared(name));
+}
+#endif
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_init),
+        cmocka_unit_test(test_write_read),
+        cmocka_unit_test(test_wrap),
+        cmocka_unit_test(test_full),
+        cmocka_unit_test(test_policy_stats),
+        cmocka_unit_test(test_read_until),
+        cmocka_unit_test(test_find),
+        cmocka_unit_test(test_dma),
+        cmocka_unit_test(test_peek_spans),
+        cmocka_unit_test(test_write_reserve),
+        cmocka_unit_test(test_iov),
+        cmocka_unit_test(test_timestamps),
+        cmocka_unit_test(test_watermarks),
+#ifdef CB_HAS_FDIO
+        cmocka_unit_test(test_fd_io),
+#endif
+#ifdef CB_HAS_MIRRORED
+        cmocka_unit_test(test_spill),
+        cmocka_unit_test(test_spill_replay),
+        cmocka_unit_test(test_mirrored),
+#endif
+        cmocka_unit_test(test_frame_decoder),
+        cmocka_unit_test(test_msg),
+        cmocka_unit_test(test_typed),
+#if defined(CB_HAS_WAIT) && defined(CB_SPSC)
+        cmocka_unit_test(test_wait),
+#endif
+        cmocka_unit_test(test_mpmc),
+        cmocka_unit_test(test_mpmc_threads),
+        cmocka_unit_test(test_bcast),
+        cmocka_unit_test(test_bcast_threads),
+#ifdef CB_IDX_CACHE
+        cmocka_unit_test(test_idx_cache),
+#endif
+#ifdef CB_HAS_SHARED
+        cmocka_unit_test(test_shared),
+        cmocka_unit_test(test_shared_recover),
+#endif
+#ifdef CB_SPSC
+        cmocka_unit_test(test_spsc_stress),
+#endif
+#ifdef CB_PACKED_LAYOUT
+        cmocka_unit_test(test_packed_layout),
+#endif
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
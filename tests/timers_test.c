@@ -0,0 +1,587 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define TIMERS_IMP
+#include "timers.h"
+
+static void test_mytimer(void){
+    mytimer_t tim;
+    MyTimerInit(&tim);
+    MyTimerStart(&tim, 3);
+    for(int i = 0; i < 4; ++i){
+        MyTimerCycle(&tim);
+        assert_false(tim.end);
+    }
+    MyTimerCycle(&tim);
+    assert_true(tim.end);
+    MyTimerReset(&tim);
+    assert_false(tim.end);
+    MyTimerStop(&tim);
+    for(int i = 0; i < 10; ++i) MyTimerCycle(&tim);
+    assert_false(tim.end);
+}
+
+#ifdef TIMERS_HAS_ATOMICS
+static void test_atimer(void){
+    atimer_t t;
+    ATimerInit(&t);
+    ATimerCycle(&t); // not started
+    assert_false(ATimerExpired(&t));
+
+    ATimerStart(&t, 3, false);
+    ATimerCycle(&t);
+    ATimerCycle(&t);
+    assert_false(ATimerExpired(&t));
+    ATimerCycle(&t);
+    assert_true(ATimerExpired(&t));
+    for(int i = 0; i < 10; ++i) ATimerCycle(&t); // one shot: raised once
+    assert_int_equal(ATimerConsume(&t), 1);
+    assert_int_equal(ATimerConsume(&t), 0);
+    ATimerReset(&t);
+    for(int i = 0; i < 3; ++i) ATimerCycle(&t);
+    assert_int_equal(ATimerConsume(&t), 1);
+
+    // periodic: nothing lost when nobody looks for a while
+    ATimerStart(&t, 2, true);
+    for(int i = 0; i < 11; ++i) ATimerCycle(&t);
+    assert_int_equal(ATimerConsume(&t), 5);
+    ATimerCycle(&t);
+    assert_int_equal(ATimerConsume(&t), 1);
+    ATimerStop(&t);
+    for(int i = 0; i < 10; ++i) ATimerCycle(&t);
+    assert_false(ATimerExpired(&t));
+}
+
+#define ATIMER_TICKS 2000000u
+static atimer_t at_shared;
+static _Atomic uint32_t at_consumed;
+static _Atomic bool at_done;
+
+static void * at_consumer(void * arg){
+    UNUSED_VAR(arg);
+    while(!atomic_load(&at_done)){
+        uint32_t n = ATimerConsume(&at_shared);
+        if(n) atomic_fetch_add(&at_consumed, n);
+    }
+    return NULL;
+}
+
+static void test_atimer_concurrent(void){
+    // every tick is an expiry, three threads race to consume them
+    ATimerInit(&at_shared);
+    ATimerStart(&at_shared, 1, true);
+    atomic_store(&at_consumed, 0);
+    atomic_store(&at_done, false);
+    pthread_t th[3];
+    for(size_t i = 0; i < ARRAY_LEN(th); ++i) pthread_create(&th[i], NULL, at_consumer, NULL);
+    for(uint32_t i = 0; i < ATIMER_TICKS; ++i) ATimerCycle(&at_shared);
+    atomic_store(&at_done, true);
+    for(size_t i = 0; i < ARRAY_LEN(th); ++i) pthread_join(th[i], NULL);
+    uint32_t total = atomic_load(&at_consumed) + ATimerConsume(&at_shared);
+    assert_int_equal(total, ATIMER_TICKS);
+}
+#endif
+
+// ---------------- Timing wheel ----------------
+
+typedef struct
+{
+    tw_wheel_t *w;
+    uint64_t at[8];
+    size_t n;
+}tw_log_t;
+
+static void tw_record(tw_timer_t * tim, void * ctx){
+    (void)tim;
+    tw_log_t *log = ctx;
+    if(log->n < ARRAY_LEN(log->at)) log->at[log->n] = log->w->now;
+    log->n++;
+}
+
+static void test_wheel_exact(void){
+    // timeouts around every level boundary, and a multi-hour one
+    static const uint32_t to[] = { 1, 255, 256, 257, 65535, 65536, 70000, 3u * 3600u * 1000u };
+    static const uint64_t starts[] = { 0, 200, 0xFFFFFFF0ull };
+    static tw_wheel_t w;
+    tw_timer_t tim[ARRAY_LEN(to)];
+    tw_log_t log[ARRAY_LEN(to)];
+
+    for(size_t s = 0; s < ARRAY_LEN(starts); ++s){
+        TwInit(&w, starts[s]);
+        memset(tim, 0, sizeof tim);
+        for(size_t i = 0; i < ARRAY_LEN(to); ++i){
+            log[i] = (tw_log_t){ .w = &w };
+            TwStart(&w, &tim[i], to[i], 0, tw_record, &log[i]);
+        }
+        assert_int_equal(w.active, ARRAY_LEN(to));
+        TwAdvance(&w, starts[s] + to[ARRAY_LEN(to) - 1] + 10);
+        for(size_t i = 0; i < ARRAY_LEN(to); ++i){
+            assert_int_equal(log[i].n, 1);
+            assert_int_equal(log[i].at[0], starts[s] + to[i]);
+            assert_false(TwPending(&tim[i]));
+        }
+        assert_int_equal(w.active, 0);
+    }
+}
+
+static void test_wheel_stop(void){
+    static tw_wheel_t w;
+    TwInit(&w, 0);
+    tw_timer_t a = {0}, b = {0};
+    tw_log_t la = { .w = &w }, lb = { .w = &w };
+    TwStart(&w, &a, 300, 0, tw_record, &la);
+    TwStart(&w, &b, 300, 0, tw_record, &lb);
+    TwAdvance(&w, 100);
+    TwStop(&w, &a);
+    TwStop(&w, &a); // already stopped
+    assert_false(TwPending(&a));
+    assert_int_equal(w.active, 1);
+
+    // restarting replaces the previous expiry
+    TwStart(&w, &b, 50, 0, tw_record, &lb);
+    TwAdvance(&w, 1000);
+    assert_int_equal(la.n, 0);
+    assert_int_equal(lb.n, 1);
+    assert_int_equal(lb.at[0], 150);
+}
+
+static void test_wheel_periodic(void){
+    static tw_wheel_t w;
+    TwInit(&w, 0);
+    tw_timer_t p = {0};
+    tw_log_t lp = { .w = &w };
+    TwStart(&w, &p, 7, 7, tw_record, &lp);
+    assert_int_equal(TwAdvance(&w, 56), 8);
+    assert_int_equal(lp.at[7], 56);
+    assert_true(TwPending(&p));
+
+    // a long one crosses levels on every period
+    tw_timer_t q = {0};
+    tw_log_t lq = { .w = &w };
+    TwStart(&w, &q, 1000, 70000, tw_record, &lq);
+    TwStop(&w, &p);
+    TwAdvance(&w, 56 + 1000 + 3 * 70000);
+    assert_int_equal(lq.n, 4);
+    assert_int_equal(lq.at[3], 56 + 1000 + 3 * 70000);
+}
+
+// Callback that stops its partner and rearms itself
+static tw_timer_t chain_a, chain_b;
+static size_t chain_runs;
+static void chain_cb(tw_timer_t * tim, void * ctx){
+    tw_wheel_t *w = ctx;
+    chain_runs++;
+    TwStop(w, &chain_b);
+    if(chain_runs < 3) TwStart(w, tim, 10, 0, chain_cb, w);
+}
+
+static void test_wheel_callbacks(void){
+    static tw_wheel_t w;
+    TwInit(&w, 0);
+    chain_runs = 0;
+    memset(&chain_a, 0, sizeof chain_a);
+    memset(&chain_b, 0, sizeof chain_b);
+    tw_log_t lb = { .w = &w };
+    // same slot, slots run newest first: a removes b from the list being fired
+    TwStart(&w, &chain_b, 5, 0, tw_record, &lb);
+    TwStart(&w, &chain_a, 5, 0, chain_cb, &w);
+    TwAdvance(&w, 100);
+    assert_int_equal(lb.n, 0);
+    assert_int_equal(chain_runs, 3);
+    assert_int_equal(w.active, 0);
+    assert_int_equal(w.fired, 3);
+}
+
+static void test_wheel_next_expiry(void){
+    static tw_wheel_t w;
+    TwInit(&w, 100);
+    assert_true(TwNextExpiry(&w) == UINT64_MAX);
+    tw_timer_t a = {0}, b = {0};
+    tw_log_t la = { .w = &w }, lb = { .w = &w };
+    TwStart(&w, &a, 40, 0, tw_record, &la);
+    assert_int_equal(TwNextExpiry(&w), 140);
+    // a far timer only needs the wheel at its cascade boundary
+    TwStop(&w, &a);
+    TwStart(&w, &b, 3u * 3600u * 1000u, 0, tw_record, &lb);
+    uint64_t next = TwNextExpiry(&w);
+    assert_true(next > 100 && next <= 100 + 3u * 3600u * 1000u);
+    assert_int_equal(next % 256, 0);
+
+    // the idle hours are jumped, not ticked
+    TwAdvance(&w, 100 + 3u * 3600u * 1000u);
+    assert_int_equal(lb.n, 1);
+    assert_int_equal(lb.at[0], 100 + 3u * 3600u * 1000u);
+}
+
+// ---------------- Deadline heap ----------------
+
+typedef struct
+{
+    uint64_t last;
+    size_t n;
+    bool sorted;
+}th_log_t;
+
+static void th_record(th_timer_t * tim, void * ctx){
+    th_log_t *log = ctx;
+    if(tim->period == 0 && tim->deadline < log->last) log->sorted = false;
+    log->last = tim->deadline;
+    log->n++;
+}
+
+static void test_heap_order(void){
+    enum { N = 500 };
+    static th_timer_t tim[N];
+    static th_timer_t *store[N];
+    timer_heap_t h;
+    TimerHeapInit(&h, store, N);
+    memset(tim, 0, sizeof tim);
+    th_log_t log = { .sorted = true };
+    uint32_t x = 12345;
+    for(size_t i = 0; i < N; ++i){
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        assert_true(TimerHeapStartAt(&h, &tim[i], 1000 + x % 100000, 0, th_record, &log));
+    }
+    th_timer_t extra = {0};
+    assert_false(TimerHeapStartAt(&h, &extra, 5, 0, th_record, &log)); // full
+
+    // stop every third, move some others
+    size_t stopped = 0;
+    for(size_t i = 0; i < N; i += 3){ TimerHeapStop(&h, &tim[i]); stopped++; }
+    TimerHeapStop(&h, &tim[0]);
+    size_t moved = 0;
+    for(size_t i = 1; i < N; i += 7){
+        if(i % 3 == 0) continue;
+        assert_true(TimerHeapStartAt(&h, &tim[i], 500 + i, 0, th_record, &log));
+        moved++;
+    }
+    assert_int_equal(h.len, N - stopped);
+    assert_int_equal(TimerHeapNext(&h), 501);
+
+    assert_int_equal(TimerHeapRun(&h, 1000), moved);
+    assert_int_equal(TimerHeapRun(&h, UINT64_MAX - 1), N - stopped - moved);
+    assert_true(log.sorted);
+    assert_int_equal(h.len, 0);
+    assert_true(TimerHeapNext(&h) == UINT64_MAX);
+    for(size_t i = 0; i < N; ++i) assert_false(TimerHeapPending(&tim[i]));
+}
+
+static void test_heap_periodic(void){
+    th_timer_t *store[4];
+    timer_heap_t h;
+    TimerHeapInit(&h, store, 4);
+    th_timer_t p = {0}, o = {0};
+    th_log_t lp = {0}, lo = {0};
+    TimerHeapStartAt(&h, &p, 10, 10, th_record, &lp);
+    TimerHeapStartAt(&h, &o, 25, 0, th_record, &lo);
+    // late by several periods: every one of them fires, deadlines do not drift
+    assert_int_equal(TimerHeapRun(&h, 45), 5);
+    assert_int_equal(lp.n, 4);
+    assert_int_equal(lo.n, 1);
+    assert_int_equal(p.deadline, 50);
+    assert_true(TimerHeapPending(&p));
+    assert_false(TimerHeapPending(&o));
+    assert_int_equal(TimerHeapRun(&h, 49), 0);
+}
+
+static void test_heap_next_deadline(void){
+    th_timer_t *store[2];
+    timer_heap_t h;
+    TimerHeapInit(&h, store, 2);
+    assert_int_equal(TimerNextDeadline(&h), -1);
+    th_timer_t a = {0};
+    th_log_t la = {0};
+    assert_true(TimerHeapStart(&h, &a, 40, 0, th_record, &la));
+    int to = TimerNextDeadline(&h);
+    assert_true(to > 30 && to <= 40);
+    // the loop sleeps exactly as long as needed
+    struct timespec nap = { 0, (long)to * 1000000L };
+    nanosleep(&nap, NULL);
+    while(TimerNextDeadline(&h) > 0) nanosleep(&(struct timespec){ 0, 100000L }, NULL);
+    assert_int_equal(TimerNextDeadline(&h), 0);
+    assert_int_equal(TimerHeapExpire(&h), 1);
+    assert_int_equal(TimerNextDeadline(&h), -1);
+}
+
+// ---------------- Deadline timers ----------------
+
+static void test_dtimer_grid(void){
+    timer_lat_t lat;
+    TimerLatReset(&lat);
+    dtimer_t t;
+    DTimerInit(&t, &lat);
+    assert_int_equal(DTimerCheckAt(&t, 1000), 0); // not started
+    assert_true(DTimerRemaining(&t) == UINT64_MAX);
+
+    DTimerStartAt(&t, 1000, 100);
+    assert_int_equal(DTimerCheckAt(&t, 999), 0);
+    assert_int_equal(DTimerCheckAt(&t, 1000), 1);  // exact
+    assert_int_equal(t.deadline, 1100);
+    assert_int_equal(DTimerCheckAt(&t, 1130), 1);  // 30 late, next stays on the grid
+    assert_int_equal(t.deadline, 1200);
+    assert_int_equal(DTimerCheckAt(&t, 1555), 4);  // 1200..1500 went by
+    assert_int_equal(t.deadline, 1600);
+    assert_int_equal(t.overruns, 3);
+    assert_int_equal(DTimerCheckAt(&t, 1599), 0);
+
+    assert_int_equal(lat.cnt, 3);
+    assert_int_equal(lat.max, 355);
+    assert_int_equal(lat.sum, 0 + 30 + 355);
+    assert_int_equal(lat.hist[0], 1);   // 0 ns
+    assert_int_equal(lat.hist[4], 1);   // 30 ns in [16, 32)
+    assert_int_equal(lat.hist[8], 1);   // 355 ns in [256, 512)
+    assert_int_equal(TimerLatPercentile(&lat, 50), 31);
+    assert_int_equal(TimerLatPercentile(&lat, 99), 511);
+
+    // one shot
+    DTimerStartAt(&t, 2000, 0);
+    assert_int_equal(DTimerCheckAt(&t, 5000), 1);
+    assert_false(t.on);
+    assert_int_equal(DTimerCheckAt(&t, 9000), 0);
+    TimerLatReset(&lat);
+    assert_int_equal(TimerLatPercentile(&lat, 50), 0);
+}
+
+static void test_dtimer_no_drift(void){
+    // a sloppy caller (every ~3 ms with jitter) on a 10 ms period: after
+    // 200 ms exactly 20 periods have elapsed, none stretched
+    dtimer_t t;
+    DTimerInit(&t, NULL);
+    uint64_t start = now_ns();
+    DTimerStartAt(&t, start + DTIMER_MS(10), DTIMER_MS(10));
+    uint32_t periods = 0;
+    uint64_t now;
+    while((now = now_ns()) < start + DTIMER_MS(200)){
+        periods += DTimerCheckAt(&t, now);
+        struct timespec nap = { 0, 2500000L + (long)(now % 1000000u) };
+        nanosleep(&nap, NULL);
+    }
+    periods += DTimerCheckAt(&t, start + DTIMER_MS(200));
+    assert_int_equal(periods, 20);
+    assert_int_equal(t.deadline, start + DTIMER_MS(210));
+    assert_true(DTimerRemaining(&t) <= DTIMER_MS(10)); // 0 if this thread was preempted past 210 ms
+}
+
+static void test_clock_ns(void){
+    // before calibration: OS clock, cycles are ns
+    assert_int_equal(cycles_to_ns(123456789), 123456789);
+    uint64_t a = now_ns(), b = now_ns();
+    assert_true(b >= a);
+    assert_true(now_us() >= a / 1000);
+
+    // continuous with the OS clock, and scales like it. A preemption inside
+    // the calibration or between paired reads skews one try, not five.
+    bool tsc = false, ok = false;
+    for(int attempt = 0; attempt < 5 && !ok; ++attempt){
+        tsc = TimersClockCalibrate(20);
+#ifndef TIMERS_HAS_TSC
+        assert_false(tsc);
+#endif
+        uint64_t os0 = os_now_ns(), t0 = now_ns(), c0 = now_cycles();
+        struct timespec nap = { 0, 30 * 1000000L };
+        nanosleep(&nap, NULL);
+        uint64_t os1 = os_now_ns(), t1 = now_ns(), c1 = now_cycles();
+        int64_t err = (int64_t)(t1 - t0) - (int64_t)(os1 - os0);
+        uint64_t via_cycles = cycles_to_ns(c1 - c0);
+        ok = t0 + 1000000 > os0 && t0 < os0 + 1000000 &&
+             err > -200000 && err < 200000 && // 0.2 ms over 30 ms
+             via_cycles > (os1 - os0) * 9 / 10 && via_cycles < (os1 - os0) * 11 / 10;
+    }
+    assert_true(ok);
+    if(tsc) assert_true(timers_clk.mult != (1ull << TIMERS_TSC_SHIFT));
+
+    uint64_t prev = now_ns();
+    for(int i = 0; i < 100000; ++i){
+        uint64_t n = now_ns();
+        assert_true(n >= prev);
+        prev = n;
+    }
+}
+
+#ifdef TIMERS_HAS_SVC
+static void test_svc(void){
+    static tw_wheel_t w;
+    timer_svc_t svc;
+    TwInit(&w, 0);
+    assert_true(TimerSvcInit(&svc, &w));
+    assert_true(TimerSvcFd(&svc) >= 0);
+    assert_true(now_ms() - w.now <= 1);
+
+    tw_timer_t one = {0}, per = {0};
+    tw_log_t lo = { .w = &w }, lp = { .w = &w };
+    uint64_t t0 = now_ms();
+    TimerSvcStart(&svc, &one, 30, 0, tw_record, &lo);
+    // sleeps on the fd until the expiry, no timeout needed
+    while(lo.n == 0) TimerSvcWait(&svc, -1);
+    assert_true(now_ms() >= t0 + 30);
+    assert_true(svc.wakeups <= 3);
+    assert_int_equal(svc.armed, 0);
+
+    // missed ticks: nobody dispatches for 50 ms, every period still fires
+    TimerSvcStart(&svc, &per, 5, 5, tw_record, &lp);
+    uint64_t t1 = w.now;
+    struct timespec nap = { 0, 50 * 1000000L };
+    nanosleep(&nap, NULL);
+    TimerSvcWait(&svc, 0);
+    assert_true(lp.n >= 10);
+    assert_int_equal(lp.n, (w.now - t1) / 5);
+    assert_true(svc.armed > w.now);
+
+    TimerSvcStop(&svc, &per);
+    assert_int_equal(svc.armed, 0);
+    assert_int_equal(TimerSvcWait(&svc, 20), 0);
+    TimerSvcClose(&svc);
+}
+#endif
+
+#ifdef TIMERS_HAS_DISP
+static int disp_cnt[3];
+#define DISP_CNT(i) __atomic_load_n(&disp_cnt[i], __ATOMIC_RELAXED)
+static timer_h disp_self;
+
+static void disp_count(timer_h h, void * ctx){
+    UNUSED_VAR(h);
+    __atomic_fetch_add((int *)ctx, 1, __ATOMIC_RELAXED);
+}
+
+// cancels itself on the third run
+static void disp_self_cancel(timer_h h, void * ctx){
+    if(__atomic_add_fetch((int *)ctx, 1, __ATOMIC_RELAXED) == 3) assert_true(TimerCancel(h));
+    assert_int_equal(h, disp_self);
+}
+
+static void disp_sleep_ms(long ms){
+    struct timespec nap = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&nap, NULL);
+}
+
+static void test_dispatcher(void){
+    timer_h one = TimerAdd(10, true, disp_count, &disp_cnt[0]);
+    timer_h per = TimerAdd(5, false, disp_count, &disp_cnt[1]);
+    disp_self = TimerAdd(3, false, disp_self_cancel, &disp_cnt[2]);
+    assert_true(one && per && disp_self);
+    assert_int_equal(TimerAdd(0, false, disp_count, NULL), 0);
+    assert_true(TimerActive(one));
+
+    disp_sleep_ms(60);
+    assert_int_equal(DISP_CNT(0), 1);
+    assert_false(TimerActive(one));      // one-shot released its slot
+    assert_false(TimerCancel(one));
+    assert_int_equal(DISP_CNT(2), 3);
+    assert_false(TimerActive(disp_self));
+
+    assert_true(TimerCancel(per));
+    int seen = DISP_CNT(1);
+    assert_true(seen >= 5);
+    disp_sleep_ms(20);
+    assert_int_equal(DISP_CNT(1), seen); // nothing after cancel returned
+
+    // slots are recycled, old handles stay stale
+    timer_h again = TimerAdd(1000, true, disp_count, &disp_cnt[0]);
+    assert_true(again != 0 && again != one);
+    assert_false(TimerCancel(one));
+
+    TimerDispatcherStop();
+    assert_false(TimerActive(again));
+    // restarts on demand
+    timer_h after = TimerAdd(5, true, disp_count, &disp_cnt[0]);
+    assert_true(after != 0);
+    disp_sleep_ms(30);
+    assert_int_equal(DISP_CNT(0), 2);
+    TimerDispatcherStop();
+}
+
+// callbacks must run on the dispatcher even when timers come from elsewhere
+static _Atomic size_t disp_wrong_thread, disp_x_runs;
+
+static void disp_check_thread(timer_h h, void * ctx){
+    UNUSED_VAR(h); UNUSED_VAR(ctx);
+    if(!pthread_equal(pthread_self(), timer_disp.th)) atomic_fetch_add(&disp_wrong_thread, 1);
+    atomic_fetch_add(&disp_x_runs, 1);
+}
+
+static void disp_check_cancel_self(timer_h h, void * ctx){
+    disp_check_thread(h, ctx);
+    TimerCancel(h); // would deadlock off the dispatcher
+}
+
+static void * disp_churn(void * arg){
+    UNUSED_VAR(arg);
+    for(uint32_t i = 0; i < 200000u; ++i){
+        timer_h h = TimerAdd(1, false, disp_check_cancel_self, NULL);
+        if((i & 1023u) == 0){
+            // occasionally let one run and cancel itself
+            struct timespec nap = { 0, 2000000L };
+            nanosleep(&nap, NULL);
+        }
+        TimerCancel(h);
+    }
+    return NULL;
+}
+
+static void test_dispatcher_cross_thread(void){
+    atomic_store(&disp_wrong_thread, 0);
+    atomic_store(&disp_x_runs, 0);
+    timer_h tick = TimerAdd(1, false, disp_check_thread, NULL);
+    assert_true(tick != 0);
+    pthread_t th;
+    pthread_create(&th, NULL, disp_churn, NULL);
+    pthread_join(th, NULL);
+    assert_true(TimerCancel(tick));
+    assert_true(atomic_load(&disp_x_runs) > 0);
+    assert_int_equal(atomic_load(&disp_wrong_thread), 0);
+    TimerDispatcherStop();
+}
+
+static void test_dispatcher_stale_handle(void){
+    // 65536 reuses of one slot must not bring an old handle back to life
+    timer_h old = TimerAdd(10000, true, disp_check_thread, NULL);
+    assert_true(TimerCancel(old));
+    size_t idx = (size_t)(old & 0xFFFFFFFFu) - 1;
+    timer_disp.slot[idx].gen += 65535u;
+    timer_h h = TimerAdd(10000, true, disp_check_thread, NULL);
+    assert_int_equal(h & 0xFFFFFFFFu, old & 0xFFFFFFFFu); // same slot
+    assert_true(h != old);
+    assert_false(TimerCancel(old));
+    assert_true(TimerActive(h));
+    TimerDispatcherStop();
+}
+#endif
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_mytimer),
+#ifdef TIMERS_HAS_ATOMICS
+        cmocka_unit_test(test_atimer),
+        cmocka_unit_test(test_atimer_concurrent),
+#endif
+        cmocka_unit_test(test_wheel_exact),
+        cmocka_unit_test(test_wheel_stop),
+        cmocka_unit_test(test_wheel_periodic),
+        cmocka_unit_test(test_wheel_callbacks),
+        cmocka_unit_test(test_wheel_next_expiry),
+        cmocka_unit_test(test_heap_order),
+        cmocka_unit_test(test_heap_periodic),
+        cmocka_unit_test(test_heap_next_deadline),
+        cmocka_unit_test(test_dtimer_grid),
+        cmocka_unit_test(test_dtimer_no_drift),
+        cmocka_unit_test(test_clock_ns),
+#ifdef TIMERS_HAS_SVC
+        cmocka_unit_test(test_svc),
+#endif
+#ifdef TIMERS_HAS_DISP
+        cmocka_unit_test(test_dispatcher),
+        cmocka_unit_test(test_dispatcher_cross_thread),
+        cmocka_unit_test(test_dispatcher_stale_handle),
+#endif
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}